@@ -0,0 +1,38 @@
+/** \file
+ *
+ *  Column gathering of the key matrices (matrix.c, Keyb.c and Keyb-pcb.c).
+ *
+ *  Each port is read once per row, then every nibble of it that has column pins goes through a 16 entry table
+ *  giving the columns closed for each value of the nibble. The tables are built by the compiler from the column of
+ *  each pin, so a new pin map is a new list of columns.
+ */
+
+#ifndef _COLUMNS_H_
+#define _COLUMNS_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// Macros
+// Columns closed when a nibble of a port reads N, its pins going to the column masks C0 to C3 (0 for none), lowest
+// pin first. The pins are pulled up, so a closed key reads low.
+#define COLUMNS_OF_NIBBLE(N, C0, C1, C2, C3) \
+	(((N) & 0x1 ? 0 : (C0)) | ((N) & 0x2 ? 0 : (C1)) | ((N) & 0x4 ? 0 : (C2)) | ((N) & 0x8 ? 0 : (C3)))
+
+// Initializer of the table of a port nibble, for every value it can read.
+#define COLUMN_TABLE(C0, C1, C2, C3) { \
+	COLUMNS_OF_NIBBLE(0x0, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0x1, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0x2, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0x3, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0x4, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0x5, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0x6, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0x7, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0x8, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0x9, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0xA, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0xB, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0xC, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0xD, C0, C1, C2, C3), \
+	COLUMNS_OF_NIBBLE(0xE, C0, C1, C2, C3), COLUMNS_OF_NIBBLE(0xF, C0, C1, C2, C3) }
+
+// Columns closed on the low and high nibble of a port read, through their tables in PROGMEM.
+#define COLUMNS_LOW(Table, Pins)  pgm_read_word(&(Table)[(Pins) & 0x0F])
+#define COLUMNS_HIGH(Table, Pins) pgm_read_word(&(Table)[(uint8_t)(Pins) >> 4])
+
+#endif
@@ -0,0 +1,50 @@
+/*
+Per key debouncing of the key matrices, with vertical counters.
+
+Each column of a row counts the samples in a row that differed from its
+debounced state, with a DEBOUNCE_BITS bit counter. The low bits of all the
+counters of a row are one word, the next bits another and so on, so a sample
+updates every column of the row at once with a few logic operations, the way
+an adder would count them in parallel. A sample that agrees with the state
+clears the counter, and the Samples-th one in a row that doesn't flips the
+state. The matrices pass as many samples as they scan in DEBOUNCE_MS, so the
+window is the same however fast they scan.
+
+A bouncing key only holds up itself. The single timer the matrices had before
+was restarted by any bounce of any key, which delayed every other change.
+
+Eager columns are pressed at their first closed sample: a switch doesn't
+close by itself, so the first contact is a press. Their releases, and the
+bounces after a press, still have to hold for the count.
+*/
+
+#include "Debounce.h"
+
+// Take a sample of the columns of a row, and return their debounced state. A change counts at the Samples-th sample in
+// a row that has it. The columns of Eager are pressed at their first sample that reads closed; only their releases are
+// debounced.
+uint16_t Debounce_Row(DebounceRow_t* const Row, const uint16_t Sample, const uint16_t Eager, const uint8_t Samples) {
+	// Columns that differ from their state count one more; the others start over.
+	const uint16_t delta = Sample ^ Row->State;
+	uint16_t carry = delta;
+	uint16_t reached = delta;
+	uint16_t flip;
+
+	for (uint8_t i = 0; i < DEBOUNCE_BITS; i++)
+	{
+		const uint16_t count = Row->Count[i];
+
+		Row->Count[i] = (count ^ carry) & delta;
+		carry &= count;
+		// Counters whose bits all match those of Samples.
+		reached &= (Samples & (1 << i)) ? Row->Count[i] : ~Row->Count[i];
+	}
+
+	// Counters that reached Samples, and eager presses.
+	flip = reached | (delta & Sample & Eager);
+	for (uint8_t i = 0; i < DEBOUNCE_BITS; i++)
+		Row->Count[i] &= ~flip;
+	Row->State ^= flip;
+
+	return Row->State;
+}
@@ -0,0 +1,34 @@
+/** \file
+ *
+ *  Header file for Debounce.c.
+ */
+
+#ifndef _DEBOUNCE_H_
+#define _DEBOUNCE_H_
+
+/* Includes: */
+#include <stdint.h>
+
+// Macros
+// Milliseconds a key must hold a change for before it counts: the debounce window, longer than a switch bounces.
+#define DEBOUNCE_MS          4
+// Samples that make up the window for a matrix scanned rate_hz times a second.
+#define DEBOUNCE_SAMPLES(rate_hz) (DEBOUNCE_MS * 1UL * (rate_hz) / 1000)
+// Bits of the counters, and so the most samples a window can take.
+#define DEBOUNCE_BITS        4
+#define DEBOUNCE_MAX_SAMPLES ((1 << DEBOUNCE_BITS) - 1)
+
+// Type Defines
+// Debouncing of a row of up to 16 columns. All zero is a row with every key up.
+typedef struct {
+	uint16_t State;                 // Debounced columns, 1 for a closed key
+	uint16_t Count[DEBOUNCE_BITS];  // Bits of each column's count of samples that differed from State, lowest first
+} DebounceRow_t;
+
+// Function Prototypes
+// Take a sample of the columns of a row, and return their debounced state. A change counts at the Samples-th sample in
+// a row that has it, 1 to DEBOUNCE_MAX_SAMPLES. The columns of Eager are pressed at their first sample that reads
+// closed; only their releases are debounced.
+uint16_t Debounce_Row(DebounceRow_t* const Row, const uint16_t Sample, const uint16_t Eager, const uint8_t Samples);
+
+#endif
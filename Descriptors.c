@@ -1,6 +1,106 @@
 #include "Descriptors.h"
 
 // HID Descriptors.
+#ifdef PRO_CONTROLLER
+// The Switch Pro Controller's. Only the usages of the 0x30 report are spelled out, and they don't match what
+// ProController.c sends in it; the Switch goes by the report IDs, as the other reports are vendor data anyway.
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM JoystickReport[] = {
+	HID_RI_USAGE_PAGE(8,1), /* Generic Desktop */
+	HID_RI_LOGICAL_MINIMUM(8,0),
+	HID_RI_USAGE(8,4), /* Joystick */
+	HID_RI_COLLECTION(8,1), /* Application */
+		// Full input report (PRO_IN_FULL): buttons, sticks and HAT, then 52 more bytes
+		HID_RI_REPORT_ID(8,0x30),
+		HID_RI_USAGE_PAGE(8,1),
+		HID_RI_USAGE_PAGE(8,9),
+		HID_RI_USAGE_MINIMUM(8,1),
+		HID_RI_USAGE_MAXIMUM(8,10),
+		HID_RI_LOGICAL_MINIMUM(8,0),
+		HID_RI_LOGICAL_MAXIMUM(8,1),
+		HID_RI_REPORT_SIZE(8,1),
+		HID_RI_REPORT_COUNT(8,10),
+		HID_RI_UNIT_EXPONENT(8,0),
+		HID_RI_UNIT(8,0),
+		HID_RI_INPUT(8,2),
+		HID_RI_USAGE_PAGE(8,9),
+		HID_RI_USAGE_MINIMUM(8,11),
+		HID_RI_USAGE_MAXIMUM(8,14),
+		HID_RI_LOGICAL_MINIMUM(8,0),
+		HID_RI_LOGICAL_MAXIMUM(8,1),
+		HID_RI_REPORT_SIZE(8,1),
+		HID_RI_REPORT_COUNT(8,4),
+		HID_RI_INPUT(8,2),
+		HID_RI_REPORT_SIZE(8,1),
+		HID_RI_REPORT_COUNT(8,2),
+		HID_RI_INPUT(8,3),
+		HID_RI_USAGE(32,0x010001), /* Pointer */
+		HID_RI_COLLECTION(8,0), /* Physical */
+			HID_RI_USAGE(32,0x010030), /* X */
+			HID_RI_USAGE(32,0x010031), /* Y */
+			HID_RI_USAGE(32,0x010032), /* Z */
+			HID_RI_USAGE(32,0x010035), /* Rz */
+			HID_RI_LOGICAL_MINIMUM(8,0),
+			HID_RI_LOGICAL_MAXIMUM(32,65535),
+			HID_RI_REPORT_SIZE(8,16),
+			HID_RI_REPORT_COUNT(8,4),
+			HID_RI_INPUT(8,2),
+		HID_RI_END_COLLECTION(0),
+		HID_RI_USAGE(32,0x010039), /* Hat Switch */
+		HID_RI_LOGICAL_MINIMUM(8,0),
+		HID_RI_LOGICAL_MAXIMUM(8,7),
+		HID_RI_PHYSICAL_MINIMUM(8,0),
+		HID_RI_PHYSICAL_MAXIMUM(16,315),
+		HID_RI_UNIT(8,20),
+		HID_RI_REPORT_SIZE(8,4),
+		HID_RI_REPORT_COUNT(8,1),
+		HID_RI_INPUT(8,2),
+		HID_RI_USAGE_PAGE(8,9),
+		HID_RI_USAGE_MINIMUM(8,15),
+		HID_RI_USAGE_MAXIMUM(8,18),
+		HID_RI_LOGICAL_MINIMUM(8,0),
+		HID_RI_LOGICAL_MAXIMUM(8,1),
+		HID_RI_REPORT_SIZE(8,1),
+		HID_RI_REPORT_COUNT(8,4),
+		HID_RI_INPUT(8,2),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,52),
+		HID_RI_INPUT(8,3),
+		// Vendor reports, 63 bytes after the ID: answers to subcommands (PRO_IN_REPLY) and USB commands (PRO_IN_USB) in,
+		// subcommands (PRO_OUT_SUBCOMMAND), rumble (PRO_OUT_RUMBLE), USB commands (PRO_OUT_USB) and 0x82 out
+		HID_RI_USAGE_PAGE(16,65280),
+		HID_RI_REPORT_ID(8,0x21),
+		HID_RI_USAGE(8,1),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,63),
+		HID_RI_INPUT(8,3),
+		HID_RI_REPORT_ID(8,0x81),
+		HID_RI_USAGE(8,2),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,63),
+		HID_RI_INPUT(8,3),
+		HID_RI_REPORT_ID(8,0x01),
+		HID_RI_USAGE(8,3),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,63),
+		HID_RI_OUTPUT(8,131),
+		HID_RI_REPORT_ID(8,0x10),
+		HID_RI_USAGE(8,4),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,63),
+		HID_RI_OUTPUT(8,131),
+		HID_RI_REPORT_ID(8,0x80),
+		HID_RI_USAGE(8,5),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,63),
+		HID_RI_OUTPUT(8,131),
+		HID_RI_REPORT_ID(8,0x82),
+		HID_RI_USAGE(8,6),
+		HID_RI_REPORT_SIZE(8,8),
+		HID_RI_REPORT_COUNT(8,63),
+		HID_RI_OUTPUT(8,131),
+	HID_RI_END_COLLECTION(0),
+};
+#else
 const USB_Descriptor_HIDReport_Datatype_t PROGMEM JoystickReport[] = {
 	HID_RI_USAGE_PAGE(8,1), /* Generic Desktop */
 	HID_RI_USAGE(8,5), /* Joystick */
@@ -56,6 +156,14 @@ const USB_Descriptor_HIDReport_Datatype_t PROGMEM JoystickReport[] = {
 		HID_RI_OUTPUT(8,2),
 	HID_RI_END_COLLECTION(0),
 };
+#endif
+
+#ifdef TELEMETRY_INTERFACE
+// Raw HID Descriptor of the telemetry interface: TELEMETRY_EPSIZE bytes of vendor data each way.
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM TelemetryReport[] = {
+	HID_DESCRIPTOR_VENDOR(0x00, 0x01, 0x02, 0x03, TELEMETRY_EPSIZE)
+};
+#endif
 
 // Device Descriptor Structure
 const USB_Descriptor_Device_t PROGMEM DeviceDescriptor = {
@@ -68,9 +176,15 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor = {
 
 	.Endpoint0Size          = FIXED_CONTROL_ENDPOINT_SIZE,
 
+	#ifdef PRO_CONTROLLER
+	.VendorID               = 0x057E,
+	.ProductID              = 0x2009,
+	.ReleaseNumber          = VERSION_BCD(2,0,0),
+	#else
 	.VendorID               = 0x0F0D,
 	.ProductID              = 0x0092,
 	.ReleaseNumber          = VERSION_BCD(1,0,0),
+	#endif
 
 	.ManufacturerStrIndex   = STRING_ID_Manufacturer,
 	.ProductStrIndex        = STRING_ID_Product,
@@ -86,7 +200,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
 			.Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
 			.TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-			.TotalInterfaces        = 1,
+			.TotalInterfaces        = INTERFACE_TOTAL,
 
 			.ConfigurationNumber    = 1,
 			.ConfigurationStrIndex  = NO_DESCRIPTOR,
@@ -130,7 +244,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
 			.EndpointAddress        = JOYSTICK_IN_EPADDR,
 			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
 			.EndpointSize           = JOYSTICK_EPSIZE,
-			.PollingIntervalMS      = 0x05
+			.PollingIntervalMS      = JOYSTICK_POLLING_MS
 		},
 
 	.HID_ReportOUTEndpoint =
@@ -140,16 +254,120 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor = {
 			.EndpointAddress        = JOYSTICK_OUT_EPADDR,
 			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
 			.EndpointSize           = JOYSTICK_EPSIZE,
-			.PollingIntervalMS      = 0x05
+			.PollingIntervalMS      = JOYSTICK_POLLING_MS
+		},
+
+	#ifdef TELEMETRY_INTERFACE
+	.Telemetry_Interface =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+			.InterfaceNumber        = INTERFACE_ID_Telemetry,
+			.AlternateSetting       = 0x00,
+
+			.TotalEndpoints         = 2,
+
+			.Class                  = HID_CSCP_HIDClass,
+			.SubClass               = HID_CSCP_NonBootSubclass,
+			.Protocol               = HID_CSCP_NonBootProtocol,
+
+			.InterfaceStrIndex      = NO_DESCRIPTOR
 		},
+
+	.Telemetry_HID =
+		{
+			.Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
+
+			.HIDSpec                = VERSION_BCD(1,1,1),
+			.CountryCode            = 0x00,
+			.TotalReportDescriptors = 1,
+			.HIDReportType          = HID_DTYPE_Report,
+			.HIDReportLength        = sizeof(TelemetryReport)
+		},
+
+	.Telemetry_ReportINEndpoint =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress        = TELEMETRY_IN_EPADDR,
+			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize           = TELEMETRY_EPSIZE,
+			.PollingIntervalMS      = TELEMETRY_POLLING_MS
+		},
+
+	.Telemetry_ReportOUTEndpoint =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress        = TELEMETRY_OUT_EPADDR,
+			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize           = TELEMETRY_EPSIZE,
+			.PollingIntervalMS      = TELEMETRY_POLLING_MS
+		},
+	#endif
+
+	#ifdef DUAL_CONTROLLER
+	// The second controller is a copy of the first, with its own endpoints.
+	.HID2_Interface =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+			.InterfaceNumber        = INTERFACE_ID_Joystick2,
+			.AlternateSetting       = 0x00,
+
+			.TotalEndpoints         = 2,
+
+			.Class                  = HID_CSCP_HIDClass,
+			.SubClass               = HID_CSCP_NonBootSubclass,
+			.Protocol               = HID_CSCP_NonBootProtocol,
+
+			.InterfaceStrIndex      = NO_DESCRIPTOR
+		},
+
+	.HID2_JoystickHID =
+		{
+			.Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
+
+			.HIDSpec                = VERSION_BCD(1,1,1),
+			.CountryCode            = 0x00,
+			.TotalReportDescriptors = 1,
+			.HIDReportType          = HID_DTYPE_Report,
+			.HIDReportLength        = sizeof(JoystickReport)
+		},
+
+	.HID2_ReportINEndpoint =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress        = JOYSTICK2_IN_EPADDR,
+			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize           = JOYSTICK_EPSIZE,
+			.PollingIntervalMS      = JOYSTICK_POLLING_MS
+		},
+
+	.HID2_ReportOUTEndpoint =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress        = JOYSTICK2_OUT_EPADDR,
+			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize           = JOYSTICK_EPSIZE,
+			.PollingIntervalMS      = JOYSTICK_POLLING_MS
+		},
+	#endif
 };
 
 // Language Descriptor Structure
 const USB_Descriptor_String_t PROGMEM LanguageString = USB_STRING_DESCRIPTOR_ARRAY(LANGUAGE_ID_ENG);
 
 // Manufacturer and Product Descriptor Strings
+#ifdef PRO_CONTROLLER
+const USB_Descriptor_String_t PROGMEM ManufacturerString = USB_STRING_DESCRIPTOR(L"Nintendo Co., Ltd.");
+const USB_Descriptor_String_t PROGMEM ProductString      = USB_STRING_DESCRIPTOR(L"Pro Controller");
+#else
 const USB_Descriptor_String_t PROGMEM ManufacturerString = USB_STRING_DESCRIPTOR(L"HORI CO.,LTD.");
 const USB_Descriptor_String_t PROGMEM ProductString      = USB_STRING_DESCRIPTOR(L"POKKEN CONTROLLER");
+#endif
 
 // USB Device Callback - Get Descriptor
 uint16_t CALLBACK_USB_GetDescriptor(
@@ -194,10 +412,26 @@ uint16_t CALLBACK_USB_GetDescriptor(
 		case DTYPE_HID:
 			Address = &ConfigurationDescriptor.HID_JoystickHID;
 			Size    = sizeof(USB_HID_Descriptor_HID_t);
+			#ifdef TELEMETRY_INTERFACE
+			// For HID class descriptors, wIndex is the interface the host asks about.
+			if (wIndex == INTERFACE_ID_Telemetry)
+				Address = &ConfigurationDescriptor.Telemetry_HID;
+			#endif
+			#ifdef DUAL_CONTROLLER
+			if (wIndex == INTERFACE_ID_Joystick2)
+				Address = &ConfigurationDescriptor.HID2_JoystickHID;
+			#endif
 			break;
 		case DTYPE_Report:
 			Address = &JoystickReport;
 			Size    = sizeof(JoystickReport);
+			#ifdef TELEMETRY_INTERFACE
+			if (wIndex == INTERFACE_ID_Telemetry)
+			{
+				Address = &TelemetryReport;
+				Size    = sizeof(TelemetryReport);
+			}
+			#endif
 			break;
 	}
 
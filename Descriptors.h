@@ -17,12 +17,35 @@ typedef struct
 	USB_HID_Descriptor_HID_t              HID_JoystickHID;
 	USB_Descriptor_Endpoint_t             HID_ReportOUTEndpoint;
 	USB_Descriptor_Endpoint_t             HID_ReportINEndpoint;
+
+	#ifdef TELEMETRY_INTERFACE
+	// Telemetry Raw HID Interface
+	USB_Descriptor_Interface_t            Telemetry_Interface;
+	USB_HID_Descriptor_HID_t              Telemetry_HID;
+	USB_Descriptor_Endpoint_t             Telemetry_ReportINEndpoint;
+	USB_Descriptor_Endpoint_t             Telemetry_ReportOUTEndpoint;
+	#endif
+
+	#ifdef DUAL_CONTROLLER
+	// Second Joystick HID Interface
+	USB_Descriptor_Interface_t            HID2_Interface;
+	USB_HID_Descriptor_HID_t              HID2_JoystickHID;
+	USB_Descriptor_Endpoint_t             HID2_ReportOUTEndpoint;
+	USB_Descriptor_Endpoint_t             HID2_ReportINEndpoint;
+	#endif
 } USB_Descriptor_Configuration_t;
 
 // Device Interface Descriptor IDs
 enum InterfaceDescriptors_t
 {
 	INTERFACE_ID_Joystick = 0, /**< Joystick interface descriptor ID */
+	#ifdef TELEMETRY_INTERFACE
+	INTERFACE_ID_Telemetry,    /**< Telemetry interface descriptor ID */
+	#endif
+	#ifdef DUAL_CONTROLLER
+	INTERFACE_ID_Joystick2,    /**< Second joystick interface descriptor ID */
+	#endif
+	INTERFACE_TOTAL            /**< Number of interfaces, not an ID */
 };
 
 // Device String Descriptor IDs
@@ -37,10 +60,31 @@ enum StringDescriptors_t
 // Endpoint Addresses
 #define JOYSTICK_IN_EPADDR  (ENDPOINT_DIR_IN  | 1)
 #define JOYSTICK_OUT_EPADDR (ENDPOINT_DIR_OUT | 2)
+#define TELEMETRY_IN_EPADDR  (ENDPOINT_DIR_IN  | 3)
+#define TELEMETRY_OUT_EPADDR (ENDPOINT_DIR_OUT | 4)
+#define JOYSTICK2_IN_EPADDR  (ENDPOINT_DIR_IN  | 5)
+#define JOYSTICK2_OUT_EPADDR (ENDPOINT_DIR_OUT | 6)
 // HID Endpoint Size
 // The Switch -needs- this to be 64.
 // The Wii U is flexible, allowing us to use the default of 8 (which did not match the original Hori descriptors).
 #define JOYSTICK_EPSIZE           64
+// HID IN Endpoint Banks
+// With 2, the next report is staged in the second bank while the host reads the first, so a busy main loop
+// doesn't cost a poll. The report the host reads is then one poll older, so 1 keeps latency lowest.
+#ifndef JOYSTICK_IN_BANKS
+#define JOYSTICK_IN_BANKS         1
+#endif
+// HID Endpoint Polling Interval
+// In milliseconds, as asked of the host in the endpoint descriptors. The HORI pad asks for 5; with 1 a report
+// can reach the host up to 4 ms sooner, if the host honours it (pollrate.py measures what a Linux host does).
+#ifndef JOYSTICK_POLLING_MS
+#define JOYSTICK_POLLING_MS       5
+#endif
+// Telemetry Endpoint Size, which is also the size of its reports.
+#define TELEMETRY_EPSIZE          32
+// Telemetry Endpoint Polling Interval
+// Telemetry is read on request, so the host needn't poll it any faster than the joystick.
+#define TELEMETRY_POLLING_MS      JOYSTICK_POLLING_MS
 // Descriptor Header Type - HID Class HID Descriptor
 #define DTYPE_HID                 0x21
 // Descriptor Header Type - HID Class HID Report Descriptor
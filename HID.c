@@ -0,0 +1,283 @@
+/*
+Bounded report transfers for the HID endpoints.
+
+The LUFA stream functions wait for the endpoint bank, and retrying them until
+they succeed spins the whole main loop for as long as the bus misbehaves. Our
+reports are a few bytes and always fit the bank, so they are copied straight
+into the FIFO once it is known to be free. When it isn't, the report waits for
+the next pass of the main loop and a counter records it.
+
+A poll that finds the IN bank empty is answered with a NAK, which the hardware
+flags in NAKINI. Counting those flags tells how often the main loop was too
+slow to have a report ready, which is what JOYSTICK_IN_BANKS trades against.
+
+A build whose main loop takes long passes can leave the IN endpoint to the USB
+interrupt instead. The main loop publishes each new report with
+HID_PublishReport(), and HID_SendPublishedReport(), called from the
+Start-of-Frame event, hands the latest one to the host. LUFA's endpoint
+interrupt only serves the control endpoint, but Start-of-Frame comes every
+millisecond, which is as often as the host can poll us anyway. The two report
+buffers mean the interrupt never sees a report half written: the main loop only
+fills the one the interrupt isn't reading, then flips a single byte. A report
+the same as the one published is left as it is, so HID_PublishedReportSent()
+keeps telling whether the host got it; a caller with reports to show one after
+the other waits for that before publishing the next.
+
+The control pipe gets its own way in. GET_REPORT is answered with the last
+published report, so a host polling through it reads what the endpoint would
+have given it, without a report being built for it and without the script
+moving on. SET_REPORT is the OUT report arriving another way: it is kept in a
+one report mailbox until the main loop takes it where it takes the OUT
+endpoint's, and stalled while the mailbox is full, so the host sends it again.
+
+Built with REPORT_KEEPALIVE_MS, a report is only sent when it differs from the
+last one sent, or when the keepalive runs out. In between, the IN bank is left
+empty and the host's polls are NAKed. Those NAKs are on purpose, so they aren't
+counted as missed polls. They still tell us the host is polling, and
+HID_HostPolled() passes that on to a caller that paces its work by the polls.
+*/
+
+#include "HID.h"
+
+static uint16_t defer_count = 0;
+static uint16_t missed_polls = 0;
+
+#ifdef REPORT_KEEPALIVE_MS
+// The joystick report last sent, and when.
+static USB_JoystickReport_Input_t last_sent;
+static uint16_t last_sent_time;
+static bool holding = false;         // The last report wasn't sent, so the host is being NAKed on purpose
+static bool in_flight = false;       // The last report was sent, and the host hasn't been seen taking it
+static bool polled = false;          // The host polled since HID_HostPolled() last looked
+#endif
+
+// Reports handed from the main loop to the interrupt. `published` is the one the interrupt sends.
+static USB_JoystickReport_Input_t published_reports[2] = {
+	[0 ... 1] = {
+		.HAT = HAT_CENTER,
+		.LX  = STICK_CENTER,
+		.LY  = STICK_CENTER,
+		.RX  = STICK_CENTER,
+		.RY  = STICK_CENTER
+	}
+};
+static volatile uint8_t published = 0;
+// The host was sent the published report, or already had the same one.
+static volatile bool published_sent = false;
+
+// Report of the last SET_REPORT request, until the main loop takes it.
+static uint8_t set_report[JOYSTICK_EPSIZE];
+static volatile uint8_t set_report_length;
+static volatile bool set_report_full = false;
+
+// Whether the selected IN endpoint can take a report right now.
+bool HID_CanWriteReport(void) {
+	// The host polled since we last looked and got a NAK. Several NAKs in between count once, as the
+	// main loop comes by far more often than the host polls. Writing ones leaves the other flags alone.
+	if (UEINTX & (1 << NAKINI))
+	{
+		UEINTX = (uint8_t)~(1 << NAKINI);
+		#ifdef REPORT_KEEPALIVE_MS
+		polled = true;
+		// A NAK we chose to give isn't a missed poll.
+		if (!holding)
+			missed_polls++;
+		#else
+		missed_polls++;
+		#endif
+	}
+
+	// The host hasn't taken the last report yet.
+	if (!Endpoint_IsINReady())
+		return false;
+
+	#ifdef REPORT_KEEPALIVE_MS
+	// It has now, which was a poll too.
+	if (in_flight)
+	{
+		in_flight = false;
+		polled = true;
+	}
+	#endif
+
+	// The bank is free but can't be written, such as while the endpoint is being reset.
+	if (!Endpoint_IsReadWriteAllowed())
+	{
+		defer_count++;
+		return false;
+	}
+
+	return true;
+}
+
+// Copy a report into the selected IN endpoint and send it. Only once HID_CanWriteReport() said so; it never waits.
+void HID_WriteReport(const void* const Report, const uint8_t Length) {
+	const uint8_t* const bytes = Report;
+
+	for (uint8_t i = 0; i < Length; i++)
+		Endpoint_Write_8(bytes[i]);
+
+	Endpoint_ClearIN();
+}
+
+// Take in the OUT report waiting on the selected endpoint, if any. Report may be NULL to drop it. Never waits.
+bool HID_ReadReport(void* const Report, const uint8_t Length) {
+	uint8_t* const bytes = Report;
+	bool complete = false;
+
+	if (!Endpoint_IsOUTReceived())
+		return false;
+
+	// An empty packet has nothing to read, and a short one only fills the start of the report.
+	if (Endpoint_IsReadWriteAllowed())
+	{
+		const uint16_t available = Endpoint_BytesInEndpoint();
+
+		complete = (available >= Length);
+		for (uint8_t i = 0; i < Length && i < available; i++)
+		{
+			const uint8_t byte = Endpoint_Read_8();
+
+			if (bytes)
+				bytes[i] = byte;
+		}
+	}
+
+	// Whatever was in it, we acknowledge the packet so the host can send the next one.
+	Endpoint_ClearOUT();
+	return complete;
+}
+
+// Whether Report should go to the joystick IN endpoint now that it can take one. Without REPORT_KEEPALIVE_MS, always;
+// with it, only if Report differs from the last one sent or the keepalive ran out. A report it says yes to must be sent.
+bool HID_ReportChanged(const USB_JoystickReport_Input_t* const Report, const uint16_t Now) {
+	#ifdef REPORT_KEEPALIVE_MS
+	if ((uint16_t)(Now - last_sent_time) < REPORT_KEEPALIVE_MS && memcmp(Report, &last_sent, sizeof(last_sent)) == 0)
+	{
+		holding = true;
+		return false;
+	}
+
+	last_sent = *Report;
+	last_sent_time = Now;
+	holding = false;
+	in_flight = true;
+	#endif
+
+	return true;
+}
+
+#ifdef REPORT_KEEPALIVE_MS
+// Whether the host polled the joystick IN endpoint since the last call, as seen by HID_CanWriteReport(). With send-on-change the
+// endpoint is free on every pass of the main loop, so this is what tells a poll apart.
+bool HID_HostPolled(void) {
+	const bool result = polled;
+
+	polled = false;
+	return result;
+}
+#endif
+
+// Reports that had to wait for another main loop pass because their endpoint bank couldn't be used.
+uint16_t HID_GetDeferCount(void) {
+	return defer_count;
+}
+
+// Polls of the IN endpoint that found no report waiting.
+uint16_t HID_GetMissedPollCount(void) {
+	return missed_polls;
+}
+
+// Make a report the next one the interrupt sends, and the one GET_REPORT requests get. From the main loop only.
+void HID_PublishReport(const USB_JoystickReport_Input_t* const Report) {
+	const uint8_t next = published ^ 1;
+
+	if (memcmp(Report, &published_reports[published], sizeof(USB_JoystickReport_Input_t)) == 0)
+		return;
+
+	published_reports[next] = *Report;
+	// A single byte store, so the interrupt sees either the old report or the new one.
+	published = next;
+	// Only then, as the interrupt may have sent the old one in between. At worst the new one is sent twice.
+	published_sent = false;
+}
+
+// Whether the host was sent the last published report, or already had the same one.
+bool HID_PublishedReportSent(void) {
+	return published_sent;
+}
+
+// Send the last published report if the IN endpoint can take it. From the Start-of-Frame event.
+void HID_SendPublishedReport(void) {
+	// The interrupt may have come in the middle of the main loop's work on another endpoint.
+	const uint8_t previous = Endpoint_GetCurrentEndpoint();
+	// Start-of-Frame comes every millisecond, which makes it the clock of the keepalive too.
+	static uint16_t frames = 0;
+
+	frames++;
+	if (USB_DeviceState == DEVICE_STATE_Configured)
+	{
+		Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
+		if (HID_CanWriteReport())
+		{
+			if (HID_ReportChanged(&published_reports[published], frames))
+				HID_WriteReport(&published_reports[published], sizeof(USB_JoystickReport_Input_t));
+			// Otherwise the host already has the same report.
+			published_sent = true;
+		}
+	}
+
+	Endpoint_SelectEndpoint(previous);
+}
+
+// Answer the HID class requests to the joystick interface, from the control request event.
+void HID_ControlRequest(void) {
+	const uint8_t type = USB_ControlRequest.bmRequestType;
+	const uint8_t request = USB_ControlRequest.bRequest;
+	// The high byte of wValue is the report type, 1 for input reports; the low byte the report ID.
+	const uint8_t report_type = (USB_ControlRequest.wValue >> 8) - 1;
+
+	if ((type & (CONTROL_REQTYPE_TYPE | CONTROL_REQTYPE_RECIPIENT)) != (REQTYPE_CLASS | REQREC_INTERFACE) ||
+	    USB_ControlRequest.wIndex != INTERFACE_ID_Joystick)
+		return;
+
+	#ifndef PRO_CONTROLLER
+	// The Pro Controller's reports are built as they are sent, so there's no published one to answer with.
+	if (request == HID_REQ_GetReport && (type & REQDIR_DEVICETOHOST) && report_type == HID_REPORT_ITEM_In)
+	{
+		Endpoint_ClearSETUP();
+		Endpoint_Write_Control_Stream_LE(&published_reports[published], sizeof(USB_JoystickReport_Input_t));
+		Endpoint_ClearOUT();
+		return;
+	}
+	#endif
+
+	// Left unhandled, the request is stalled and the host tries again later.
+	if (request != HID_REQ_SetReport || (type & REQDIR_DEVICETOHOST) || report_type != HID_REPORT_ITEM_Out ||
+	    set_report_full || USB_ControlRequest.wLength > sizeof(set_report))
+		return;
+
+	Endpoint_ClearSETUP();
+	Endpoint_Read_Control_Stream_LE(set_report, USB_ControlRequest.wLength);
+	Endpoint_ClearStatusStage();
+
+	set_report_length = USB_ControlRequest.wLength;
+	set_report_full = (set_report_length != 0);
+}
+
+// Take the report of the last SET_REPORT request the way HID_ReadReport() takes an OUT report. From the main loop.
+bool HID_TakeSetReport(void* const Report, const uint8_t Length) {
+	bool complete;
+
+	// The length is only good once the report is in: read it after the flag that says so.
+	if (!set_report_full)
+		return false;
+
+	complete = (set_report_length >= Length);
+
+	if (Report)
+		memcpy(Report, set_report, (set_report_length < Length) ? set_report_length : Length);
+
+	set_report_full = false;
+	return complete;
+}
@@ -0,0 +1,45 @@
+/** \file
+ *
+ *  Header file for HID.c.
+ */
+
+#ifndef _HID_H_
+#define _HID_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Joystick.h"
+
+// Function Prototypes
+// Whether the selected IN endpoint can take a report right now.
+bool HID_CanWriteReport(void);
+// Copy a report into the selected IN endpoint and send it. Only once HID_CanWriteReport() said so; it never waits.
+void HID_WriteReport(const void* const Report, const uint8_t Length);
+// Take in the OUT report waiting on the selected endpoint, if any. Report may be NULL to drop it. Never waits.
+bool HID_ReadReport(void* const Report, const uint8_t Length);
+// Whether Report should go to the joystick IN endpoint now that it can take one. Without REPORT_KEEPALIVE_MS, always;
+// with it, only if Report differs from the last one sent or the keepalive ran out. A report it says yes to must be sent.
+bool HID_ReportChanged(const USB_JoystickReport_Input_t* const Report, const uint16_t Now);
+#ifdef REPORT_KEEPALIVE_MS
+// Whether the host polled the joystick IN endpoint since the last call, as seen by HID_CanWriteReport().
+bool HID_HostPolled(void);
+#endif
+// Reports that had to wait for another main loop pass because their endpoint bank couldn't be used.
+uint16_t HID_GetDeferCount(void);
+// Polls of the IN endpoint that found no report waiting.
+uint16_t HID_GetMissedPollCount(void);
+// Make a report the next one HID_SendPublishedReport() sends, and the one GET_REPORT requests get. From the main loop only.
+void HID_PublishReport(const USB_JoystickReport_Input_t* const Report);
+// Whether the host was sent the last published report, or already had the same one. From the main loop.
+bool HID_PublishedReportSent(void);
+// Send the last published report if the IN endpoint can take it. From the Start-of-Frame event.
+void HID_SendPublishedReport(void);
+// Answer the HID class requests to the joystick interface, from the control request event: GET_REPORT with the last
+// published report, SET_REPORT by keeping its report for HID_TakeSetReport().
+void HID_ControlRequest(void);
+// Take the report of the last SET_REPORT request the way HID_ReadReport() takes an OUT report. From the main loop.
+bool HID_TakeSetReport(void* const Report, const uint8_t Length);
+
+#endif
@@ -20,178 +20,120 @@ these buttons for our use.
 
 #include "Joystick.h"
 
+#include "HID.h"
+#include "Sequencer.h"
+#include "Upload.h"
+#include "Stream.h"
+#ifdef TELEMETRY_INTERFACE
+#include "Telemetry.h"
+#endif
+#ifdef PRO_CONTROLLER
+#include "ProController.h"
+#endif
+#ifdef SCRIPT_SELECT_KEYS
+#include "matrix.h"
+#include "timer.h"
+#endif
+// The scripts, compiled from their .script files by script2c.py.
+#include "bowling_script.h"
+#include "mash_a_script.h"
+
+// Scripts this firmware can run; the script setting (see Upload.h) picks one.
+static const Script_t* const bank[] PROGMEM = {
+	&bowling_script,
+	&mash_a_script
+};
+#define BANK_SIZE (sizeof(bank) / sizeof(bank[0]))
+
+#ifdef SCRIPT_SELECT_KEYS
+// Keys of the fightstick board (see the layout of Keyb-pcb.c) that select the script at the same index when held while
+// plugging in: A, then B. matrix.c numbers its rows and columns in another order, so they're given as (row, column) of
+// matrix.c: row 0 is pin B3, and columns 6 and 5 are pins D7 and C6.
+static const uint8_t select_keys[][2] PROGMEM = {
+	{ 0, 6 },
+	{ 0, 5 }
+};
+// How long to scan before reading the keys; longer than the DEBOUNCE_MS it takes them to settle.
+#define SELECT_SETTLE_MS 20
+#endif
+
+#ifdef DUAL_CONTROLLER
+#ifdef REPORT_KEEPALIVE_MS
+#error "send-on-change keeps the state of a single controller"
+#endif
+// Bank index of the script the second controller plays. The first one plays the script setting.
+#ifndef SECOND_CONTROLLER_SCRIPT
+#define SECOND_CONTROLLER_SCRIPT 1
+#endif
+#define CONTROLLERS 2
+#else
+#define CONTROLLERS 1
+#endif
+
+#ifdef PRO_CONTROLLER
+#ifdef DUAL_CONTROLLER
+#error "the Pro Controller protocol keeps the state of a single controller"
+#endif
+#ifdef REPORT_KEEPALIVE_MS
+#error "a Pro Controller sends an input report at every poll"
+#endif
+#endif
+
 typedef enum {
-	UP,
-	DOWN,
-	LEFT,
-	RIGHT,
-	X,
-	Y,
-	A,
-	B,
-	L,
-	R,
-	THROW,
-	NOTHING,
-	TRIGGERS
-} Buttons_t;
+	SYNC_CONTROLLER,
+	SYNC_POSITION,
+	BREATHE,
+	PROCESS,
+	CLEANUP,
+	DONE
+} State_t;
+
+// Report sent while the script isn't running.
+static const USB_JoystickReport_Input_t neutral_report = {
+	.Button = 0,
+	.HAT = HAT_CENTER,
+	.LX = STICK_CENTER,
+	.LY = STICK_CENTER,
+	.RX = STICK_CENTER,
+	.RY = STICK_CENTER,
+	.VendorSpec = 0
+};
 
+// One virtual controller: the endpoints of its interface, the script it plays and where it is at.
 typedef struct {
-	Buttons_t button;
-	uint16_t duration;
-} command; 
-
-static const command step[] = {
-	// Setup controller
-	{ NOTHING,  250 },
-	{ TRIGGERS,   5 },
-	{ NOTHING,  150 },
-	{ TRIGGERS,   5 },
-	{ NOTHING,  150 },
-	{ A,          5 },
-	{ NOTHING,  250 },
-
-	// Talk to Pondo
-	{ A,          5 }, // Start
-	{ NOTHING,   30 },
-	{ B,          5 }, // Quick output of text
-	{ NOTHING,   20 }, // Halloo, kiddums!
-	{ A,          5 }, // <- I'll try it!
-	{ NOTHING,   15 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ A,          5 }, // <- OK!
-	{ NOTHING,   15 },
-	{ B,          5 },
-	{ NOTHING,   20 }, // Aha! Play bells are ringing! I gotta set up the pins, but I'll be back in a flurry
-	{ A,          5 }, // <Continue>
-	{ NOTHING,  325 }, // Cut to different scene (Knock 'em flat!)
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ A,          5 }, // <Continue> // Camera transition takes place after this
-	{ NOTHING,   50 },
-	{ B,          5 },
-	{ NOTHING,   20 }, // If you can knock over all 10 pins in one roll, that's a strike
-	{ A,          5 }, // <Continue>
-	{ NOTHING,   15 },
-	{ B,          5 },
-	{ NOTHING,   20 }, // A spare is...
-	{ A,          5 }, // <Continue>
-	{ NOTHING,  100 }, // Well, good luck
-	{ A,          5 }, // <Continue>
-	{ NOTHING,  150 }, // Pondo walks away
-
-	// Pick up Snowball (Or alternatively, run to bail in case of a non-strike)
-	{ A,          5 },
-	{ NOTHING,   50 },
-	{ LEFT,      42 },
-	{ UP,        80 },
-	{ THROW,     25 },
-
-	// Non-strike alternative flow, cancel bail and rethrow
-	{ NOTHING,   30 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 }, // I have to split dialogue (It's nothing)
-	{ NOTHING,   15 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,  450 },
-	{ B,          5 }, // Snowly moly... there are rules!
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 }, // Second dialogue
-	{ NOTHING,   20 },
-	{ DOWN,      10 }, // Return to snowball
-	{ NOTHING,   20 },
-	{ A,          5 }, // Pick up snowball, we just aimlessly throw it
-	{ NOTHING,   50 },
-	{ UP,        10 },
-	{ THROW,     25 },
-
-	// Back at main flow
-	{ NOTHING,  175 }, // Ater throw wait
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 }, // To the rewards
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	
-	{ B,          5 }, // Wait for 450 cycles by bashing B (Like real players do!)
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 },
-	{ B,          5 },
-	{ NOTHING,   20 } // Saving, intermission
+	uint8_t                           InEndpoint;
+	uint8_t                           OutEndpoint;
+	const Script_t*                   Script;
+	bool                              Uploaded;  // Script is in EEPROM
+	Sequencer_t                       Sequencer;
+	State_t                           State;
+	uint8_t                           Echoes;
+	const USB_JoystickReport_Input_t* Report;    // Report currently being sent, held for ECHOES more polls once picked
+	uint16_t                          LastFrame; // Millisecond clock of the last tick
+} Controller_t;
+
+// The first controller is the one uploads, streaming and telemetry deal with.
+static Controller_t controllers[CONTROLLERS] = {
+	{ .InEndpoint = JOYSTICK_IN_EPADDR,  .OutEndpoint = JOYSTICK_OUT_EPADDR,  .State = SYNC_CONTROLLER, .Report = &neutral_report },
+	#ifdef DUAL_CONTROLLER
+	{ .InEndpoint = JOYSTICK2_IN_EPADDR, .OutEndpoint = JOYSTICK2_OUT_EPADDR, .State = SYNC_CONTROLLER, .Report = &neutral_report },
+	#endif
 };
 
+static void SelectScript(void);
+static void LoadScript(Controller_t* const controller, uint8_t index);
+static void ReloadScript(void);
+static const USB_JoystickReport_Input_t* NextReport(Controller_t* const controller);
+static uint16_t Millis(void);
+
 // Main entry point.
 int main(void) {
 	// We'll start by performing hardware and peripheral setup.
 	SetupHardware();
 	// We'll then enable global interrupts for our use.
 	GlobalInterruptEnable();
+	// With interrupts running, we can pick the script to run.
+	SelectScript();
 	// Once that's done, we'll enter an infinite loop.
 	for (;;)
 	{
@@ -199,7 +141,65 @@ int main(void) {
 		HID_Task();
 		// We also need to run the main USB management task.
 		USB_USBTask();
+		// Scripts uploaded or selected from a PC are written to EEPROM here, and run once committed.
+		if (Upload_Task())
+			ReloadScript();
+		// Streaming from a PC starts and stops here too; once it stops, the script starts over.
+		if (Stream_Task())
+			ReloadScript();
+		#ifdef TELEMETRY_INTERFACE
+		// A PC watching the controller reads its state here, and may ask for the script to start over.
+		if (Telemetry_Task(Millis(), &controllers[0].Sequencer))
+			ReloadScript();
+		#endif
+	}
+}
+
+// Pick the script to run: a held select key wins and is remembered, otherwise the one set in EEPROM.
+static void SelectScript(void) {
+	Upload_Init();
+
+	#ifdef SCRIPT_SELECT_KEYS
+	matrix_init();
+	timer_init();
+	const uint16_t start = timer_read();
+	while (timer_elapsed(start) < SELECT_SETTLE_MS)
+		matrix_scan();
+
+	for (uint8_t i = 0; i < sizeof(select_keys) / sizeof(select_keys[0]); i++)
+	{
+		if (matrix_get_row(pgm_read_byte(&select_keys[i][0])) & (1 << pgm_read_byte(&select_keys[i][1])))
+		{
+			Upload_SetSetting(i);
+			break;
+		}
+	}
+	#endif
+
+	LoadScript(&controllers[0], Upload_GetSetting());
+	#ifdef DUAL_CONTROLLER
+	LoadScript(&controllers[1], SECOND_CONTROLLER_SCRIPT);
+	#endif
+}
+
+// Point a controller at the script a setting names: a bank index or SCRIPT_UPLOADED.
+static void LoadScript(Controller_t* const controller, uint8_t index) {
+	controller->Uploaded = false;
+	if (index == SCRIPT_UPLOADED)
+	{
+		controller->Script = Upload_GetScript();
+		if (controller->Script)
+		{
+			controller->Uploaded = true;
+			return;
+		}
 	}
+
+	// A blank EEPROM reads 0xFF, so anything out of range (or a broken upload) runs the first script.
+	if (index >= BANK_SIZE)
+		index = 0;
+
+	controller->Script = (const Script_t*)pgm_read_word(&bank[index]);
 }
 
 // Configures hardware and peripherals, such as the USB peripherals.
@@ -242,16 +242,60 @@ void EVENT_USB_Device_ConfigurationChanged(void) {
 
 	// We setup the HID report endpoints.
 	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK_OUT_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, 1);
-	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK_IN_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, 1);
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK_IN_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, JOYSTICK_IN_BANKS);
+	#ifdef TELEMETRY_INTERFACE
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(TELEMETRY_OUT_EPADDR, EP_TYPE_INTERRUPT, TELEMETRY_EPSIZE, 1);
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(TELEMETRY_IN_EPADDR, EP_TYPE_INTERRUPT, TELEMETRY_EPSIZE, 1);
+	#endif
+	#ifdef DUAL_CONTROLLER
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK2_OUT_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, 1);
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK2_IN_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, JOYSTICK_IN_BANKS);
+	#endif
+
+	// Start-of-Frame events drive the millisecond timebase of the script.
+	USB_Device_EnableSOFEvents();
 
 	// We can read ConfigSuccess to indicate a success or failure at this point.
 }
 
+// Milliseconds counted from USB Start-of-Frame packets, which the host sends every 1 ms on a full-speed bus.
+volatile uint16_t frame_count = 0;
+
+// Fired on every Start-of-Frame, from the USB interrupt.
+void EVENT_USB_Device_StartOfFrame(void) {
+	frame_count++;
+}
+
+// Read the millisecond counter.
+static uint16_t Millis(void) {
+	uint16_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = frame_count;
+	}
+
+	return now;
+}
+
+// Milliseconds since the controller's previous call.
+static uint16_t ElapsedMillis(Controller_t* const controller) {
+	const uint16_t now = Millis();
+	const uint16_t elapsed = now - controller->LastFrame;
+
+	controller->LastFrame = now;
+	return elapsed;
+}
+
 // Process control requests sent to the device from the USB host.
 void EVENT_USB_Device_ControlRequest(void) {
 	// We can handle two control requests: a GetReport and a SetReport.
+	// It looks like we don't receive them from the Switch, but PC hosts and test tools send them.
+	HID_ControlRequest();
 
-	// Not used here, it looks like we don't receive control request from the Switch.
+	// A PC can also send the vendor requests that upload and select scripts, or stream reports.
+	Upload_ControlRequest();
+	Stream_ControlRequest();
 }
 
 // Process and deliver data from IN and OUT endpoints.
@@ -260,88 +304,115 @@ void HID_Task(void) {
 	if (USB_DeviceState != DEVICE_STATE_Configured)
 		return;
 
-	// We'll start with the OUT endpoint.
-	Endpoint_SelectEndpoint(JOYSTICK_OUT_EPADDR);
-	// We'll check to see if we received something on the OUT endpoint.
-	if (Endpoint_IsOUTReceived())
+	for (Controller_t* controller = controllers; controller < controllers + CONTROLLERS; controller++)
 	{
-		// If we did, and the packet has data, we'll react to it.
-		if (Endpoint_IsReadWriteAllowed())
+		// We'll start with the OUT endpoint.
+		Endpoint_SelectEndpoint(controller->OutEndpoint);
+		// While a PC streams reports, they arrive on the OUT endpoint of the first controller.
+		if (controller == controllers && Stream_IsActive())
+			Stream_ReadEntries();
+		#ifdef PRO_CONTROLLER
+		// Otherwise the host sends the commands of the Pro Controller protocol, one at a time.
+		else
+			ProController_ReadCommand();
+		#else
+		// Otherwise we'll take in whatever the host sent on the OUT endpoint, without waiting for it.
+		// Since we're not doing anything with this data, we abandon it.
+		else
+			HID_ReadReport(NULL, sizeof(USB_JoystickReport_Output_t));
+		#endif
+
+		// The same goes for the OUT reports of SET_REPORT requests, which only come to the first interface, unless they
+		// are Pro Controller commands left for ProController_ReadCommand(). One left waiting stalls all the next ones.
+		#ifdef PRO_CONTROLLER
+		if (controller == controllers && Stream_IsActive())
+		#else
+		if (controller == controllers)
+		#endif
+			HID_TakeSetReport(NULL, sizeof(USB_JoystickReport_Output_t));
+
+		// We'll then move on to the IN endpoint.
+		Endpoint_SelectEndpoint(controller->InEndpoint);
+		// We first check to see if the host is ready to accept data and the bank can take it. If not, we try again next pass.
+		if (!HID_CanWriteReport())
+			continue;
+
+		#ifdef PRO_CONTROLLER
+		// The answer to a command goes out before the next input report, and input reports only once the host asked for them.
+		// Until then the script waits.
+		if (ProController_WriteAnswer() || !ProController_IsStarted())
+			continue;
+		#endif
+
+		#ifdef REPORT_KEEPALIVE_MS
+		// Sending only on change leaves the endpoint free all the time, so we wait for the host to poll before moving on.
+		// That keeps the script paced by the polls, and frozen while they stop.
+		if (!HID_HostPolled())
+			continue;
+		#endif
+
+		// We'll pick the report we want to send to the host. The sequencer only rebuilds it when an input changes.
+		const USB_JoystickReport_Input_t* const report = NextReport(controller);
+
+		#ifdef TELEMETRY_INTERFACE
+		if (controller == controllers)
+			Telemetry_Trace(report, Millis());
+		#endif
+		// Once picked, we copy it straight into the endpoint and send it as an IN packet, unless it's the same as the last.
+		#ifdef PRO_CONTROLLER
+		ProController_WriteReport(report);
+		#else
+		if (HID_ReportChanged(report, Millis()))
 		{
-			// We'll create a place to store our data received from the host.
-			USB_JoystickReport_Output_t JoystickOutputData;
-			// We'll then take in that data, setting it up in our storage.
-			while(Endpoint_Read_Stream_LE(&JoystickOutputData, sizeof(JoystickOutputData), NULL) != ENDPOINT_RWSTREAM_NoError);
-			// At this point, we can react to this data.
-
-			// However, since we're not doing anything with this data, we abandon it.
+			HID_WriteReport(report, sizeof(USB_JoystickReport_Input_t));
+			// GET_REPORT requests get the report the host last got from the endpoint.
+			if (controller == controllers)
+				HID_PublishReport(report);
 		}
-		// Regardless of whether we reacted to the data, we acknowledge an OUT packet on this endpoint.
-		Endpoint_ClearOUT();
-	}
-
-	// We'll then move on to the IN endpoint.
-	Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
-	// We first check to see if the host is ready to accept data.
-	if (Endpoint_IsINReady())
-	{
-		// We'll create an empty report.
-		USB_JoystickReport_Input_t JoystickInputData;
-		// We'll then populate this report with what we want to send to the host.
-		GetNextReport(&JoystickInputData);
-		// Once populated, we can output this data to the host. We do this by first writing the data to the control stream.
-		while(Endpoint_Write_Stream_LE(&JoystickInputData, sizeof(JoystickInputData), NULL) != ENDPOINT_RWSTREAM_NoError);
-		// We then send an IN packet on this endpoint.
-		Endpoint_ClearIN();
+		#endif
 	}
 }
 
-typedef enum {
-	SYNC_CONTROLLER,
-	SYNC_POSITION,
-	BREATHE,
-	PROCESS,
-	CLEANUP,
-	DONE
-} State_t;
-State_t state = SYNC_CONTROLLER;
-
 #define ECHOES 2
-int echoes = 0;
-USB_JoystickReport_Input_t last_report;
 
 int report_count = 0;
 int xpos = 0;
 int ypos = 0;
-int bufindex = 0;
-int duration_count = 0;
 int portsval = 0;
 
-// Prepare the next report for the host.
-void GetNextReport(USB_JoystickReport_Input_t* const ReportData) {
+// Start the controller's script from its first command.
+static void StartScript(Controller_t* const controller) {
+	if (controller->Uploaded)
+		Sequencer_StartEEPROM(&controller->Sequencer, controller->Script);
+	else
+		Sequencer_Start(&controller->Sequencer, controller->Script);
+}
+
+// Switch the first controller to the script the setting now names, starting it over.
+static void ReloadScript(void) {
+	LoadScript(&controllers[0], Upload_GetSetting());
+	controllers[0].State = SYNC_POSITION;
+}
 
-	// Prepare an empty report
-	memset(ReportData, 0, sizeof(USB_JoystickReport_Input_t));
-	ReportData->LX = STICK_CENTER;
-	ReportData->LY = STICK_CENTER;
-	ReportData->RX = STICK_CENTER;
-	ReportData->RY = STICK_CENTER;
-	ReportData->HAT = HAT_CENTER;
+// Pick the next report of a controller for the host.
+static const USB_JoystickReport_Input_t* NextReport(Controller_t* const controller) {
 
 	// Repeat ECHOES times the last report
-	if (echoes > 0)
+	if (controller->Echoes > 0)
 	{
-		memcpy(ReportData, &last_report, sizeof(USB_JoystickReport_Input_t));
-		echoes--;
-		return;
+		controller->Echoes--;
+		return controller->Report;
 	}
 
 	// States and moves management
-	switch (state)
+	switch (controller->State)
 	{
 
 		case SYNC_CONTROLLER:
-			state = BREATHE;
+			StartScript(controller);
+			controller->LastFrame = Millis();
+			controller->Report = &neutral_report;
+			controller->State = BREATHE;
 			break;
 
 		// case SYNC_CONTROLLER:
@@ -371,110 +442,26 @@ void GetNextReport(USB_JoystickReport_Input_t* const ReportData) {
 		// 	break;
 
 		case SYNC_POSITION:
-			bufindex = 0;
-
-
-			ReportData->Button = 0;
-			ReportData->LX = STICK_CENTER;
-			ReportData->LY = STICK_CENTER;
-			ReportData->RX = STICK_CENTER;
-			ReportData->RY = STICK_CENTER;
-			ReportData->HAT = HAT_CENTER;
-
-
-			state = BREATHE;
+			StartScript(controller);
+			controller->LastFrame = Millis();
+			controller->Report = &neutral_report;
+			controller->State = BREATHE;
 			break;
 
 		case BREATHE:
-			state = PROCESS;
+			controller->State = PROCESS;
 			break;
 
 		case PROCESS:
-
-			switch (step[bufindex].button)
-			{
-
-				case UP:
-					ReportData->LY = STICK_MIN;				
-					break;
-
-				case LEFT:
-					ReportData->LX = STICK_MIN;				
-					break;
-
-				case DOWN:
-					ReportData->LY = STICK_MAX;				
-					break;
-
-				case RIGHT:
-					ReportData->LX = STICK_MAX;				
-					break;
-
-				case A:
-					ReportData->Button |= SWITCH_A;
-					break;
-
-				case B:
-					ReportData->Button |= SWITCH_B;
-					break;
-
-				case R:
-					ReportData->Button |= SWITCH_R;
-					break;
-
-				case THROW:
-					ReportData->LY = STICK_MIN;				
-					ReportData->Button |= SWITCH_R;
-					break;
-
-				case TRIGGERS:
-					ReportData->Button |= SWITCH_L | SWITCH_R;
-					break;
-
-				default:
-					ReportData->LX = STICK_CENTER;
-					ReportData->LY = STICK_CENTER;
-					ReportData->RX = STICK_CENTER;
-					ReportData->RY = STICK_CENTER;
-					ReportData->HAT = HAT_CENTER;
-					break;
-			}
-
-			duration_count++;
-
-			if (duration_count > step[bufindex].duration)
-			{
-				bufindex++;
-				duration_count = 0;				
-			}
-
-
-			if (bufindex > (int)( sizeof(step) / sizeof(step[0])) - 1)
-			{
-
-				// state = CLEANUP;
-
-				bufindex = 7;
-				duration_count = 0;
-
-				state = BREATHE;
-
-				ReportData->LX = STICK_CENTER;
-				ReportData->LY = STICK_CENTER;
-				ReportData->RX = STICK_CENTER;
-				ReportData->RY = STICK_CENTER;
-				ReportData->HAT = HAT_CENTER;
-
-
-				// state = DONE;
-//				state = BREATHE;
-
-			}
-
+			if (controller == controllers && Stream_IsActive())
+				controller->Report = Stream_Tick(ElapsedMillis(controller));
+			else
+				controller->Report = Sequencer_Tick(&controller->Sequencer, ElapsedMillis(controller));
 			break;
 
 		case CLEANUP:
-			state = DONE;
+			controller->Report = &neutral_report;
+			controller->State = DONE;
 			break;
 
 		case DONE:
@@ -484,7 +471,7 @@ void GetNextReport(USB_JoystickReport_Input_t* const ReportData) {
 			PORTB = portsval;
 			_delay_ms(250);
 			#endif
-			return;
+			return controller->Report;
 	}
 
 	// // Inking
@@ -492,8 +479,7 @@ void GetNextReport(USB_JoystickReport_Input_t* const ReportData) {
 	// 	if (pgm_read_byte(&(image_data[(xpos / 8) + (ypos * 40)])) & 1 << (xpos % 8))
 	// 		ReportData->Button |= SWITCH_A;
 
-	// Prepare to echo this report
-	memcpy(&last_report, ReportData, sizeof(USB_JoystickReport_Input_t));
-	echoes = ECHOES;
-
+	// Hold this report for the next ECHOES polls
+	controller->Echoes = ECHOES;
+	return controller->Report;
 }
@@ -42,6 +42,8 @@
 #include <avr/power.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+#include <util/atomic.h>
 #include <string.h>
 
 #include <LUFA/Drivers/USB/USB.h>
@@ -117,7 +119,6 @@ void EVENT_USB_Device_Connect(void);
 void EVENT_USB_Device_Disconnect(void);
 void EVENT_USB_Device_ConfigurationChanged(void);
 void EVENT_USB_Device_ControlRequest(void);
-// Prepare the next report for the host.
-void GetNextReport(USB_JoystickReport_Input_t* const ReportData);
+void EVENT_USB_Device_StartOfFrame(void);
 
 #endif
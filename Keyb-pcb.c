@@ -20,83 +20,128 @@ these buttons for our use.
 
 #include <avr/io.h>
 #include "Joystick.h"
+#include "HID.h"
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
+#include "Columns.h"
+#include "Debounce.h"
+#include "ScanTimer.h"
+
+#ifdef PRO_CONTROLLER
+#error "the Pro Controller protocol is only spoken by Joystick.c"
+#endif
+
+#ifdef DUAL_CONTROLLER
+#error "the second controller is only driven by Joystick.c"
+#endif
+
+#ifdef TELEMETRY_INTERFACE
+#error "the telemetry interface is only served by Joystick.c"
+#endif
 
 #define MATRIX_ROWS 3
 #define MATRIX_COLS 10
-#define DEBOUNCE 5
+// Columns whose presses count at their first contact, only their releases being debounced (see Debounce.c): all of
+// them, so that a press reaches the report at once. `make debounce-presses` debounces presses too.
+#ifndef EAGER_COLS
+#define EAGER_COLS 0xFFFF
+#endif
 #define CONSOLE_ENABLE
 
 
 typedef uint16_t matrix_row_t;
 
-typedef enum {
-	UP,
-	DOWN,
-	LEFT,
-	RIGHT,
-	X,
-	Y,
-	A,
-	B,
-	L,
-	R,
-	THROW,
-	NOTHING,
-	TRIGGERS
-} Buttons_t;
+// Directions of the pad, two bits per axis: the one towards STICK_MIN, then the one towards STICK_MAX.
+#define PAD_UP    0x01
+#define PAD_DOWN  0x02
+#define PAD_LEFT  0x04
+#define PAD_RIGHT 0x08
 
+// MINUS and PLUS click the left and right sticks while ZL or ZR is held; the clicks are the bits two above them.
+#define STICK_CLICKS(Button) (((Button) & (SWITCH_MINUS | SWITCH_PLUS)) << 2)
+
+// What a key presses: buttons of the report (JoystickButtons_t bits) and directions of the pad.
 typedef struct {
-	Buttons_t button;
-	uint16_t duration;
-} command; 
+	uint16_t Button;
+	uint8_t  Pad;
+} KeyMask_t;
+
+// The layout: what each key of the matrix presses, by row and column. Another layout only needs another table.
+static const KeyMask_t layout[MATRIX_ROWS][MATRIX_COLS] PROGMEM = {
+	[0] = {
+		[1] = { .Button = SWITCH_CAPTURE },
+		[2] = { .Button = SWITCH_MINUS },
+		[3] = { .Button = SWITCH_PLUS },
+		[4] = { .Button = SWITCH_HOME }
+	},
+	[1] = {
+		[0] = { .Pad = PAD_LEFT },
+		[1] = { .Pad = PAD_DOWN },
+		[2] = { .Pad = PAD_RIGHT },
+		[3] = { .Button = SWITCH_B },
+		[4] = { .Button = SWITCH_A },
+		[5] = { .Button = SWITCH_R },
+		[6] = { .Button = SWITCH_ZR }
+	},
+	[2] = {
+		[1] = { .Pad = PAD_UP },
+		[3] = { .Button = SWITCH_Y },
+		[4] = { .Button = SWITCH_X },
+		[5] = { .Button = SWITCH_L },
+		[6] = { .Button = SWITCH_ZL }
+	}
+};
+
+// HAT position of each combination of PAD_* bits. Opposite directions held together cancel out (SOCD cleaning).
+static const uint8_t hat_table[16] PROGMEM = {
+	HAT_CENTER,       HAT_TOP,          HAT_BOTTOM,       HAT_CENTER,
+	HAT_LEFT,         HAT_TOP_LEFT,     HAT_BOTTOM_LEFT,  HAT_LEFT,
+	HAT_RIGHT,        HAT_TOP_RIGHT,    HAT_BOTTOM_RIGHT, HAT_RIGHT,
+	HAT_CENTER,       HAT_TOP,          HAT_BOTTOM,       HAT_CENTER
+};
+
+// Stick position along an axis from its two PAD_* bits, cancelling out the same way.
+static const uint8_t axis_table[4] PROGMEM = { STICK_CENTER, STICK_MIN, STICK_MAX, STICK_CENTER };
 
 typedef struct {
-	bool UP;
-	bool DOWN;
-	bool LEFT;
-	bool RIGHT;
-	bool R_UP;
-	bool R_DOWN;
-	bool R_LEFT;
-	bool R_RIGHT;
-	bool X;
-	bool Y;
-	bool A;
-	bool B;
-	bool L;
-	bool R;
-	bool ZL;
-	bool ZR;
-	bool L3;
-	bool R3;
-	bool CAPTURE;
-	bool HOME;
-	bool MINUS;
-	bool PLUS;
-	bool H_TOP;
-	bool H_BOTTOM;
-	bool H_LEFT;
-	bool H_RIGHT;
-	uint8_t HAT;
+	uint16_t Button;  // Buttons of the report
+	uint8_t  Pad;     // PAD_* bits of the directions on the HAT
+	uint8_t  LStick;  // PAD_* bits of the directions on the left stick
+	uint8_t  RStick;  // and on the right one
 } keystate;
 
-static keystate ks = { false, false, false, false, false, false, false, false, false, false };
-static bool debouncing = false;
-static uint16_t debouncing_time = 0;
+static keystate ks;
+
+// Changes of the key state, from the scans to the reports, oldest first: a ring written at head by the scan
+// interrupt and read at tail by the main loop, which takes an entry with interrupts off so that a full ring can drop
+// its oldest one from the interrupt. A power of two, so the indexes wrap for free.
+#define CHANGES_SIZE 8
+static keystate changes[CHANGES_SIZE];
+static volatile uint8_t changes_head = 0;
+static volatile uint8_t changes_tail = 0;
+// The last state queued, and the one in the reports. All keys up to start with.
+static keystate queued;
+static keystate shown;
+
+// Written by the scans, from the timer interrupt (see ScanTimer.c). As many samples as the scans take in DEBOUNCE_MS.
+#define SCAN_SAMPLES DEBOUNCE_SAMPLES(SCAN_RATE_HZ)
+#if SCAN_SAMPLES < 1 || SCAN_SAMPLES > DEBOUNCE_MAX_SAMPLES
+#error "SCAN_RATE_HZ takes too few or too many samples in DEBOUNCE_MS for the debouncing counters"
+#endif
+static DebounceRow_t debounce[MATRIX_ROWS];
 
 
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 static matrix_row_t read_cols(void);
 static void init_cols(void);
 void unselect_rows(void);
 void select_row(uint8_t row);
 uint16_t matrix_get_row(uint16_t row);
+// Prepare the next report for the host, from the state of the keys.
+void GetNextReport(USB_JoystickReport_Input_t* const ReportData);
 
 // Main entry point.
 int main(void) {
@@ -105,10 +150,11 @@ int main(void) {
 	// We'll then enable global interrupts for our use.
 	GlobalInterruptEnable();
 	matrix_init();
+	// The matrix is scanned from the timer interrupt from now on.
+	ScanTimer_Init();
 	// Once that's done, we'll enter an infinite loop.
 	for (;;)
 	{
-		keyboard_task();
 		// We need to run our task to process and deliver data for our IN and OUT endpoints.
 		HID_Task();
 		// We also need to run the main USB management task.
@@ -139,42 +185,14 @@ void matrix_print(void)
 }
 
 uint16_t matrix_get_row(uint16_t row) {
-	return matrix[row];
-}
+	uint16_t cols;
 
-void keyboard_task(void){
-	static matrix_row_t matrix_prev[MATRIX_ROWS];
-#ifdef MATRIX_HAS_GHOST
-	static matrix_row_t matrix_ghost[MATRIX_ROWS];
-#endif
-	matrix_row_t matrix_row = 0;
-	matrix_row_t matrix_change = 0;
-
-	matrix_scan();
-	for (uint8_t r = 0; r < MATRIX_ROWS; r++) {
-		matrix_row = matrix_get_row(r);
-		matrix_change = matrix_row ^ matrix_prev[r];
-		if (matrix_change) {
-/*
-#ifdef MATRIX_HAS_GHOST
-			if (has_ghost_in_row(r)) {
-				matrix_ghost[r] = matrix_row;
-				continue;
-			}
-			matrix_ghost[r] = matrix_row;
-#endif
-*/
-			//if (true) matrix_print();
-			matrix_row_t col_mask = 1;
-			for (uint8_t c = 0; c < MATRIX_COLS; c++, col_mask <<=1) {
-				if (matrix_change & col_mask) {
-					ks.A = true;
-					matrix_prev[r] ^= col_mask;
-				}
-			}
-		}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		cols = matrix[row];
 	}
-	
+
+	return cols;
 }
 
 void matrix_init(void) {
@@ -182,8 +200,8 @@ void matrix_init(void) {
 	init_cols();
 	for (uint8_t i=0; i < MATRIX_ROWS; i++) {
 		matrix[i] = 0;
-		matrix_debouncing[i] = 0;
 	}
+	memset(debounce, 0, sizeof(debounce));
 }
 
 void  init_cols(void)
@@ -201,134 +219,110 @@ void  init_cols(void)
     PORTB |=  (1<<4);
 }
 
+// Columns of the pins of each port nibble, lowest pin first: D1 D0 D4 C6 D7 E6 B4 are columns 0 to 6.
+static const matrix_row_t cols_d_low[16] PROGMEM = COLUMN_TABLE(1<<1, 1<<0, 0, 0);
+static const matrix_row_t cols_d_high[16] PROGMEM = COLUMN_TABLE(1<<2, 0, 0, 1<<4);
+static const matrix_row_t cols_c_high[16] PROGMEM = COLUMN_TABLE(0, 0, 1<<3, 0);
+static const matrix_row_t cols_e_high[16] PROGMEM = COLUMN_TABLE(0, 0, 1<<5, 0);
+static const matrix_row_t cols_b_high[16] PROGMEM = COLUMN_TABLE(1<<6, 0, 0, 0);
+
 matrix_row_t read_cols(void){
-	return (PIND&(1<<1) ? 0 : (1<<0)) |
-           (PIND&(1<<0) ? 0 : (1<<1)) |
-           (PIND&(1<<4) ? 0 : (1<<2)) |
-           (PINC&(1<<6) ? 0 : (1<<3)) |
-           (PIND&(1<<7) ? 0 : (1<<4)) |
-           (PINE&(1<<6) ? 0 : (1<<5)) |
-           (PINB&(1<<4) ? 0 : (1<<6));
+	// One read of each port, back to back, so that all columns are sampled together.
+	const uint8_t d = PIND, c = PINC, e = PINE, b = PINB;
+
+	return COLUMNS_LOW(cols_d_low, d) | COLUMNS_HIGH(cols_d_high, d) |
+	       COLUMNS_HIGH(cols_c_high, c) | COLUMNS_HIGH(cols_e_high, e) |
+	       COLUMNS_HIGH(cols_b_high, b);
+}
+
+// Whether State has every key of Other pressed.
+static bool Covers(const keystate* const State, const keystate* const Other) {
+	return !(Other->Button & ~State->Button) && !(Other->Pad & ~State->Pad) &&
+	       !(Other->LStick & ~State->LStick) && !(Other->RStick & ~State->RStick);
+}
+
+// Queue the key state of a scan for the reports if it changed. From the scan interrupt.
+//
+// A report is only sampled at the host's polls, so a press between two of them would never reach the host. Every
+// change is queued instead, and the reports show them one per poll (see GetNextReport()). A change that presses more
+// keys on top of the newest one still waiting takes its place, if that one only pressed more keys on top of the
+// change before it: a run of presses is sent as one, but a release always gets its own report, so a press, release and
+// press again still reach the host as two presses. Once full, the ring drops its oldest change.
+static void QueueChange(const keystate* const State) {
+	const uint8_t waiting = changes_head - changes_tail;
+	keystate* const newest = &changes[(uint8_t)(changes_head - 1) % CHANGES_SIZE];
+	const keystate* const before = (waiting >= 2) ? &changes[(uint8_t)(changes_head - 2) % CHANGES_SIZE] : &shown;
+
+	if (!memcmp(State, &queued, sizeof(keystate)))
+		return;
+
+	queued = *State;
+
+	if (waiting && Covers(newest, before) && Covers(State, newest))
+	{
+		*newest = *State;
+		return;
+	}
+
+	if (waiting == CHANGES_SIZE)
+		changes_tail++;
+	changes[changes_head % CHANGES_SIZE] = *State;
+	changes_head++;
 }
 
 void matrix_scan(void) {
-	ks.UP = false;
-	ks.DOWN = false;
-	ks.LEFT = false;
-	ks.RIGHT = false;
-	ks.R_UP = false;
-	ks.R_DOWN = false;
-	ks.R_LEFT = false;
-	ks.R_RIGHT = false;
-	ks.H_TOP = false;
-	ks.H_BOTTOM = false;
-	ks.H_LEFT = false;
-	ks.H_RIGHT = false;
-	ks.X = false;
-	ks.B = false;
-	ks.Y = false;
-	ks.A = false;
-	ks.R = false;
-	ks.L = false;
-	ks.ZR = false;
-	ks.ZL = false;
-	ks.L3 = false;
-	ks.R3 = false;
-	ks.CAPTURE = false;
-	ks.HOME = false;
-	ks.MINUS = false;
-	ks.PLUS = false;
-	ks.HAT = HAT_CENTER;
+	KeyMask_t keys = { 0, 0 };
+
 	for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
  		select_row(i);
 		_delay_us(1);
 		matrix_row_t cols = read_cols();
-		if (i == 2 && cols&(1<<1)) ks.H_TOP = true; //up
-		if (i == 1 && cols&(1<<1)) ks.H_BOTTOM = true; //down
-		if (i == 1 && cols&(1<<0)) ks.H_LEFT = true; //left
-		if (i == 1 && cols&(1<<2)) ks.H_RIGHT = true; //right
-		if (i == 2 && cols&(1<<4)) ks.X = true;
-		if (i == 1 && cols&(1<<3)) ks.B = true;
-		if (i == 2 && cols&(1<<3)) ks.Y = true;
-		if (i == 1 && cols&(1<<4)) ks.A = true;
-		if (i == 1 && cols&(1<<5)) ks.R = true;
-		if (i == 2 && cols&(1<<5)) ks.L = true;
-		if (i == 1 && cols&(1<<6)) ks.ZR = true;
-		if (i == 2 && cols&(1<<6)) ks.ZL = true;
-		if (i == 0 && cols&(1<<1)) ks.CAPTURE = true;
-		if (i == 0 && cols&(1<<4)) ks.HOME = true;
-		if (i == 0 && cols&(1<<2)) ks.MINUS = true;
-		if (i == 0 && cols&(1<<3)) ks.PLUS = true;
-
-		if (matrix_debouncing[i] != cols) {
-			if (debouncing) {
-				dprintf("bounce: %d %d@%02X\n", timer_elapsed(debouncing_time), i, matrix_debouncing[i]^cols);
+		unselect_rows();
+		matrix[i] = Debounce_Row(&debounce[i], cols, EAGER_COLS, SCAN_SAMPLES);
+
+		// OR together what the closed keys of the row press.
+		const KeyMask_t* key = layout[i];
+		for (matrix_row_t c = matrix[i]; c; c >>= 1, key++) {
+			if (c & 1) {
+				keys.Button |= pgm_read_word(&key->Button);
+				keys.Pad |= pgm_read_byte(&key->Pad);
 			}
-			matrix_debouncing[i] = cols;
-			debouncing = true;
-			debouncing_time = timer_read();
 		}
-		unselect_rows();
-	}
-
-	//HAT SOCD cleaning
-	if (ks.H_TOP && ks.H_BOTTOM) {
-		ks.H_TOP = false;
-		ks.H_BOTTOM = false;
-	}
-	if (ks.H_LEFT && ks.H_RIGHT) {
-		ks.H_LEFT = false;
-		ks.H_RIGHT = false;
 	}
 
-	//HAT INPUT
-	if (ks.H_TOP) {
-		if (ks.H_LEFT) ks.HAT = HAT_TOP_LEFT;
-		else if (ks.H_RIGHT) ks.HAT = HAT_TOP_RIGHT;
-		else ks.HAT = HAT_TOP;
-	}
-	else if (ks.H_BOTTOM) {
-		if (ks.H_LEFT) ks.HAT = HAT_BOTTOM_LEFT;
-		else if (ks.H_RIGHT) ks.HAT = HAT_BOTTOM_RIGHT;
-		else ks.HAT = HAT_BOTTOM;
-	}
-	else {
-		if (ks.H_LEFT) ks.HAT = HAT_LEFT;
-		else if (ks.H_RIGHT) ks.HAT = HAT_RIGHT;
-	}
+	ks.Button = keys.Button;
+	ks.Pad = keys.Pad;
+	ks.LStick = 0;
+	ks.RStick = 0;
 
 	//right joystick mod
-	if (ks.ZR) {
-		ks.R_LEFT = ks.H_LEFT;
-		ks.R_RIGHT = ks.H_RIGHT;
-		ks.R_UP = ks.H_TOP;
-		ks.R_DOWN = ks.H_BOTTOM;
-		ks.L3 = ks.MINUS;
-		ks.R3 = ks.PLUS;
-		ks.PLUS = false;
-		ks.HAT = HAT_CENTER;
+	if (ks.Button & SWITCH_ZR) {
+		ks.RStick = ks.Pad;
+		ks.Button |= STICK_CLICKS(ks.Button);
+		ks.Button &= ~SWITCH_PLUS;
 	}
 
 	//left joystick mod
-	if (ks.ZL) {
-		ks.LEFT = ks.H_LEFT;
-		ks.RIGHT = ks.H_RIGHT;
-		ks.UP = ks.H_TOP;
-		ks.DOWN = ks.H_BOTTOM;
-		ks.L3 = ks.MINUS;
-		ks.R3 = ks.PLUS;
-		ks.MINUS = false;
-		ks.HAT = HAT_CENTER;
+	if (ks.Button & SWITCH_ZL) {
+		ks.LStick = ks.Pad;
+		ks.Button |= STICK_CLICKS(ks.Button);
+		ks.Button &= ~SWITCH_MINUS;
 	}
 
-	if (debouncing && timer_elapsed(debouncing_time) >= DEBOUNCE) {
-		for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-			matrix[i] = matrix_debouncing[i];
-		}
-		debouncing = false;
-	}
-	return 1;
+	// The directions went to a stick instead of the HAT.
+	if (ks.Button & (SWITCH_ZR | SWITCH_ZL))
+		ks.Pad = 0;
+
+	QueueChange(&ks);
+}
+
+// Scan the matrix SCAN_RATE_HZ times a second, each scan a sample of the debouncing counters of its rows.
+ISR(TIMER1_COMPA_vect) {
+	ScanTimer_Start();
+	matrix_scan();
+	ScanTimer_End();
 }
+
 void unselect_rows(void)
 {
     // Hi-Z(DDR:0, PORT:0) to unselect
@@ -396,16 +390,26 @@ void EVENT_USB_Device_ConfigurationChanged(void) {
 
 	// We setup the HID report endpoints.
 	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK_OUT_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, 1);
-	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK_IN_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, 1);
+	ConfigSuccess &= Endpoint_ConfigureEndpoint(JOYSTICK_IN_EPADDR, EP_TYPE_INTERRUPT, JOYSTICK_EPSIZE, JOYSTICK_IN_BANKS);
+
+	// Start-of-Frame events deliver the IN reports, see HID_SendPublishedReport().
+	USB_Device_EnableSOFEvents();
 
 	// We can read ConfigSuccess to indicate a success or failure at this point.
 }
 
+// Fired on every Start-of-Frame, from the USB interrupt. The host gets the last published report however long the scan takes.
+void EVENT_USB_Device_StartOfFrame(void) {
+	HID_SendPublishedReport();
+}
+
 // Process control requests sent to the device from the USB host.
 void EVENT_USB_Device_ControlRequest(void) {
 	// We can handle two control requests: a GetReport and a SetReport.
-
-	// Not used here, it looks like we don't receive control request from the Switch.
+	// It looks like we don't receive them from the Switch, but PC hosts and test tools send them.
+	HID_ControlRequest();
+	// And the timing of the matrix scans, for scanjitter.py.
+	ScanTimer_ControlRequest();
 }
 
 // Process and deliver data from IN and OUT endpoints.
@@ -416,269 +420,40 @@ void HID_Task(void) {
 
 	// We'll start with the OUT endpoint.
 	Endpoint_SelectEndpoint(JOYSTICK_OUT_EPADDR);
-	// We'll check to see if we received something on the OUT endpoint.
-	if (Endpoint_IsOUTReceived())
-	{
-		// If we did, and the packet has data, we'll react to it.
-		if (Endpoint_IsReadWriteAllowed())
-		{
-			// We'll create a place to store our data received from the host.
-			USB_JoystickReport_Output_t JoystickOutputData;
-			// We'll then take in that data, setting it up in our storage.
-			while(Endpoint_Read_Stream_LE(&JoystickOutputData, sizeof(JoystickOutputData), NULL) != ENDPOINT_RWSTREAM_NoError);
-			// At this point, we can react to this data.
-
-			// However, since we're not doing anything with this data, we abandon it.
-		}
-		// Regardless of whether we reacted to the data, we acknowledge an OUT packet on this endpoint.
-		Endpoint_ClearOUT();
-	}
-
-	// We'll then move on to the IN endpoint.
-	Endpoint_SelectEndpoint(JOYSTICK_IN_EPADDR);
-	// We first check to see if the host is ready to accept data.
-	if (Endpoint_IsINReady())
-	{
-		// We'll create an empty report.
-		USB_JoystickReport_Input_t JoystickInputData;
-		// We'll then populate this report with what we want to send to the host.
-		GetNextReport(&JoystickInputData);
-		// Once populated, we can output this data to the host. We do this by first writing the data to the control stream.
-		while(Endpoint_Write_Stream_LE(&JoystickInputData, sizeof(JoystickInputData), NULL) != ENDPOINT_RWSTREAM_NoError);
-		// We then send an IN packet on this endpoint.
-		Endpoint_ClearIN();
-	}
+	// We'll take in whatever the host sent on the OUT endpoint, without waiting for it.
+	// Since we're not doing anything with this data, we abandon it.
+	HID_ReadReport(NULL, sizeof(USB_JoystickReport_Output_t));
+	// The same goes for the OUT reports of SET_REPORT requests.
+	HID_TakeSetReport(NULL, sizeof(USB_JoystickReport_Output_t));
+
+	// The IN endpoint is served from the Start-of-Frame interrupt, we only hand it the latest state of the stick.
+	USB_JoystickReport_Input_t JoystickInputData;
+	// We'll populate this report with what we want to send to the host.
+	GetNextReport(&JoystickInputData);
+	// Once populated, we publish it for the interrupt to send at the next poll.
+	HID_PublishReport(&JoystickInputData);
 }
 
-typedef enum {
-	SYNC_CONTROLLER,
-	SYNC_POSITION,
-	BREATHE,
-	PROCESS,
-	CLEANUP,
-	DONE
-} State_t;
-State_t state = SYNC_CONTROLLER;
-
-#define ECHOES 2
-int echoes = 0;
-USB_JoystickReport_Input_t last_report;
-
-int report_count = 0;
-int xpos = 0;
-int ypos = 0;
-int bufindex = 0;
-int duration_count = 0;
-int portsval = 0;
-
 // Prepare the next report for the host.
 void GetNextReport(USB_JoystickReport_Input_t* const ReportData) {
-
-	// Prepare an empty report
-	memset(ReportData, 0, sizeof(USB_JoystickReport_Input_t));
-	ReportData->LX = STICK_CENTER;
-	ReportData->LY = STICK_CENTER;
-	ReportData->RX = STICK_CENTER;
-	ReportData->RY = STICK_CENTER;
-	ReportData->HAT = HAT_CENTER;
-
-	// Repeat ECHOES times the last report
-	/*
-	if (echoes > 0)
-	{
-		memcpy(ReportData, &last_report, sizeof(USB_JoystickReport_Input_t));
-		echoes--;
-		return;
-	}
-	*/
-
-	// States and moves management
-	/*
-	switch (state)
+	// Move on to the next change the scans queued once the host was sent the one shown, so that each reaches it, in order.
+	if (HID_PublishedReportSent())
 	{
-
-		case SYNC_CONTROLLER:
-			state = BREATHE;
-			break;
-
-		// case SYNC_CONTROLLER:
-		// 	if (report_count > 550)
-		// 	{
-		// 		report_count = 0;
-		// 		state = SYNC_POSITION;
-		// 	}
-		// 	else if (report_count == 250 || report_count == 300 || report_count == 325)
-		// 	{
-		// 		ReportData->Button |= SWITCH_L | SWITCH_R;
-		// 	}
-		// 	else if (report_count == 350 || report_count == 375 || report_count == 400)
-		// 	{
-		// 		ReportData->Button |= SWITCH_A;
-		// 	}
-		// 	else
-		// 	{
-		// 		ReportData->Button = 0;
-		// 		ReportData->LX = STICK_CENTER;
-		// 		ReportData->LY = STICK_CENTER;
-		// 		ReportData->RX = STICK_CENTER;
-		// 		ReportData->RY = STICK_CENTER;
-		// 		ReportData->HAT = HAT_CENTER;
-		// 	}
-		// 	report_count++;
-		// 	break;
-
-		case SYNC_POSITION:
-			bufindex = 0;
-
-
-			ReportData->Button = 0;
-			ReportData->LX = STICK_CENTER;
-			ReportData->LY = STICK_CENTER;
-			ReportData->RX = STICK_CENTER;
-			ReportData->RY = STICK_CENTER;
-			ReportData->HAT = HAT_CENTER;
-
-
-			state = BREATHE;
-			break;
-
-		case BREATHE:
-			state = PROCESS;
-			break;
-
-		case PROCESS:
-*/
-			ReportData->Button = 0;
-			if (ks.X) ReportData->Button += SWITCH_X;
-			if (ks.B) ReportData->Button += SWITCH_B;
-			if (ks.Y) ReportData->Button += SWITCH_Y;
-			if (ks.A) ReportData->Button += SWITCH_A;
-			if (ks.R) ReportData->Button += SWITCH_R;
-			if (ks.L) ReportData->Button += SWITCH_L;
-			if (ks.ZR) ReportData->Button += SWITCH_ZR;
-			if (ks.ZL) ReportData->Button += SWITCH_ZL;
-			if (ks.CAPTURE) ReportData->Button += SWITCH_CAPTURE;
-			if (ks.HOME) ReportData->Button += SWITCH_HOME;
-			if (ks.MINUS) ReportData->Button += SWITCH_MINUS;
-			if (ks.PLUS) ReportData->Button += SWITCH_PLUS;
-			if (ks.UP) ReportData->LY = STICK_MIN;
-			if (ks.DOWN) ReportData->LY = STICK_MAX;
-			if (ks.LEFT) ReportData->LX = STICK_MIN;
-			if (ks.RIGHT) ReportData->LX = STICK_MAX;
-			if (ks.R_UP) ReportData->RY = STICK_MIN;
-			if (ks.R_DOWN) ReportData->RY = STICK_MAX;
-			if (ks.R_LEFT) ReportData->RX = STICK_MIN;
-			if (ks.R_RIGHT) ReportData->RX = STICK_MAX;
-			if (ks.L3) ReportData->Button += SWITCH_LCLICK;
-			if (ks.R3) ReportData->Button += SWITCH_RCLICK;
-			ReportData->HAT = ks.HAT;
-/*
-			switch (step[bufindex].button)
-			{
-
-				case UP:
-					ReportData->LY = STICK_MIN;				
-					break;
-
-				case LEFT:
-					ReportData->LX = STICK_MIN;				
-					break;
-
-				case DOWN:
-					ReportData->LY = STICK_MAX;				
-					break;
-
-				case RIGHT:
-					ReportData->LX = STICK_MAX;				
-					break;
-
-				case A:
-					ReportData->Button |= SWITCH_A;
-					break;
-
-				case B:
-					ReportData->Button |= SWITCH_B;
-					break;
-
-				case R:
-					ReportData->Button |= SWITCH_R;
-					break;
-
-				case THROW:
-					ReportData->LY = STICK_MIN;				
-					ReportData->Button |= SWITCH_R;
-					break;
-
-				case TRIGGERS:
-					ReportData->Button |= SWITCH_L | SWITCH_R;
-					break;
-
-				default:
-					ReportData->LX = STICK_CENTER;
-					ReportData->LY = STICK_CENTER;
-					ReportData->RX = STICK_CENTER;
-					ReportData->RY = STICK_CENTER;
-					ReportData->HAT = HAT_CENTER;
-					break;
-			}
-
-			duration_count++;
-
-			if (duration_count > step[bufindex].duration)
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if (changes_tail != changes_head)
 			{
-				bufindex++;
-				duration_count = 0;				
+				shown = changes[changes_tail % CHANGES_SIZE];
+				changes_tail++;
 			}
-
-
-			if (bufindex > (int)( sizeof(step) / sizeof(step[0])) - 1)
-			{
-
-				// state = CLEANUP;
-
-				bufindex = 7;
-				duration_count = 0;
-
-				state = BREATHE;
-
-				ReportData->LX = STICK_CENTER;
-				ReportData->LY = STICK_CENTER;
-				ReportData->RX = STICK_CENTER;
-				ReportData->RY = STICK_CENTER;
-				ReportData->HAT = HAT_CENTER;
-
-
-				// state = DONE;
-//				state = BREATHE;
-
-			} */
-/*
-			state = BREATHE;
-
-			break;
-
-		case CLEANUP:
-			state = DONE;
-			break;
-
-		case DONE:
-			#ifdef ALERT_WHEN_DONE
-			portsval = ~portsval;
-			PORTD = portsval; //flash LED(s) and sound buzzer if attached
-			PORTB = portsval;
-			_delay_ms(250);
-			#endif
-			return;
+		}
 	}
-*/
-
-	// // Inking
-	// if (state != SYNC_CONTROLLER && state != SYNC_POSITION)
-	// 	if (pgm_read_byte(&(image_data[(xpos / 8) + (ypos * 40)])) & 1 << (xpos % 8))
-	// 		ReportData->Button |= SWITCH_A;
-
-	// Prepare to echo this report
-	memcpy(&last_report, ReportData, sizeof(USB_JoystickReport_Input_t));
-	//echoes = ECHOES;
 
+	memset(ReportData, 0, sizeof(USB_JoystickReport_Input_t));
+	ReportData->Button = shown.Button;
+	ReportData->LX = pgm_read_byte(&axis_table[shown.LStick >> 2]);
+	ReportData->LY = pgm_read_byte(&axis_table[shown.LStick & (PAD_UP | PAD_DOWN)]);
+	ReportData->RX = pgm_read_byte(&axis_table[shown.RStick >> 2]);
+	ReportData->RY = pgm_read_byte(&axis_table[shown.RStick & (PAD_UP | PAD_DOWN)]);
+	ReportData->HAT = pgm_read_byte(&hat_table[shown.Pad]);
 }
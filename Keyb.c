@@ -23,10 +23,16 @@ these buttons for our use.
 #include "timer.h"
 #include "print.h"
 #include "debug.h"
+#include "Columns.h"
+#include "Debounce.h"
 
 #define MATRIX_ROWS 3
 #define MATRIX_COLS 10
-#define DEBOUNCE 5
+// Columns whose presses count at their first contact, only their releases being debounced (see Debounce.c): all of
+// them, so that a press reaches the report at once. `make debounce-presses` debounces presses too.
+#ifndef EAGER_COLS
+#define EAGER_COLS 0xFFFF
+#endif
 #define CONSOLE_ENABLE
 
 
@@ -73,19 +79,22 @@ typedef struct {
 } keystate;
 
 static keystate ks = { false, false, false, false, false, false, false, false, false, false };
-static bool debouncing = false;
-static uint16_t debouncing_time = 0;
+// The matrix is scanned once per millisecond, each scan a sample of the debouncing counters of its rows.
+#define SCAN_SAMPLES DEBOUNCE_SAMPLES(1000)
+static DebounceRow_t debounce[MATRIX_ROWS];
+static uint16_t scan_time = 0;
 
 
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 static matrix_row_t read_cols(void);
 static void init_cols(void);
 void unselect_rows(void);
 void select_row(uint8_t row);
 uint16_t matrix_get_row(uint16_t row);
+// Prepare the next report for the host, from the state of the keys.
+void GetNextReport(USB_JoystickReport_Input_t* const ReportData);
 
 // Main entry point.
 int main(void) {
@@ -93,6 +102,7 @@ int main(void) {
 	SetupHardware();
 	// We'll then enable global interrupts for our use.
 	GlobalInterruptEnable();
+	timer_init();
 	matrix_init();
 	// Once that's done, we'll enter an infinite loop.
 	for (;;)
@@ -157,7 +167,6 @@ void keyboard_task(void){
 			matrix_row_t col_mask = 1;
 			for (uint8_t c = 0; c < MATRIX_COLS; c++, col_mask <<=1) {
 				if (matrix_change & col_mask) {
-					ks.A = true;
 					matrix_prev[r] ^= col_mask;
 				}
 			}
@@ -171,8 +180,8 @@ void matrix_init(void) {
 	init_cols();
 	for (uint8_t i=0; i < MATRIX_ROWS; i++) {
 		matrix[i] = 0;
-		matrix_debouncing[i] = 0;
 	}
+	memset(debounce, 0, sizeof(debounce));
 }
 
 void  init_cols(void)
@@ -190,20 +199,27 @@ void  init_cols(void)
     PORTB |=  (1<<4 | 1<<5);
 }
 
+// Columns of the pins of each port nibble, lowest pin first: D3 D2 D1 D0 D4 C6 D7 E6 B4 B5 are columns 0 to 9.
+static const matrix_row_t cols_d_low[16] PROGMEM = COLUMN_TABLE(1<<3, 1<<2, 1<<1, 1<<0);
+static const matrix_row_t cols_d_high[16] PROGMEM = COLUMN_TABLE(1<<4, 0, 0, 1<<6);
+static const matrix_row_t cols_c_high[16] PROGMEM = COLUMN_TABLE(0, 0, 1<<5, 0);
+static const matrix_row_t cols_e_high[16] PROGMEM = COLUMN_TABLE(0, 0, 1<<7, 0);
+static const matrix_row_t cols_b_high[16] PROGMEM = COLUMN_TABLE(1<<8, 1<<9, 0, 0);
+
 matrix_row_t read_cols(void){
-	return (PIND&(1<<3) ? 0 : (1<<0)) |
-           (PIND&(1<<2) ? 0 : (1<<1)) |
-           (PIND&(1<<1) ? 0 : (1<<2)) |
-           (PIND&(1<<0) ? 0 : (1<<3)) |
-           (PIND&(1<<4) ? 0 : (1<<4)) |
-           (PINC&(1<<6) ? 0 : (1<<5)) |
-           (PIND&(1<<7) ? 0 : (1<<6)) |
-           (PINE&(1<<6) ? 0 : (1<<7)) |
-           (PINB&(1<<4) ? 0 : (1<<8)) |
-           (PINB&(1<<5) ? 0 : (1<<9));
+	// One read of each port, back to back, so that all columns are sampled together.
+	const uint8_t d = PIND, c = PINC, e = PINE, b = PINB;
+
+	return COLUMNS_LOW(cols_d_low, d) | COLUMNS_HIGH(cols_d_high, d) |
+	       COLUMNS_HIGH(cols_c_high, c) | COLUMNS_HIGH(cols_e_high, e) |
+	       COLUMNS_HIGH(cols_b_high, b);
 }
 
 void matrix_scan(void) {
+	if (timer_read() == scan_time)
+		return;
+	scan_time = timer_read();
+
 	ks.UP = false;
 	ks.DOWN = false;
 	ks.LEFT = false;
@@ -224,6 +240,9 @@ void matrix_scan(void) {
  		select_row(i);
 		_delay_us(1);
 		matrix_row_t cols = read_cols();
+		unselect_rows();
+		cols = matrix[i] = Debounce_Row(&debounce[i], cols, EAGER_COLS, SCAN_SAMPLES);
+
 		if (i == 2 && cols&(1<<2)) ks.UP = true;
 		if (i == 1 && cols&(1<<2)) ks.DOWN = true;
 		if (i == 1 && cols&(1<<1)) ks.LEFT = true;
@@ -240,24 +259,7 @@ void matrix_scan(void) {
 		if (i == 0 && cols&(1<<5)) ks.HOME = true;
 		if (i == 1 && cols&(1<<4)) ks.MINUS = true;
 		if (i == 1 && cols&(1<<5)) ks.PLUS = true;
-		if (matrix_debouncing[i] != cols) {
-			if (debouncing) {
-				dprintf("bounce: %d %d@%02X\n", timer_elapsed(debouncing_time), i, matrix_debouncing[i]^cols);
-			}
-			matrix_debouncing[i] = cols;
-			debouncing = true;
-			debouncing_time = timer_read();
-		}
-		unselect_rows();
-	}
-
-	if (debouncing && timer_elapsed(debouncing_time) >= DEBOUNCE) {
-		for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-			matrix[i] = matrix_debouncing[i];
-		}
-		debouncing = false;
 	}
-	return 1;
 }
 void unselect_rows(void)
 {
@@ -0,0 +1,326 @@
+/*
+Pro Controller personality, built with `make pro`.
+
+The HORI pad's report has a byte per stick axis and nothing else. The Switch
+Pro Controller has 12 bits per axis, an IMU and a protocol of its own, which
+the Switch only talks to a controller that shows up with Nintendo's IDs and
+report descriptor (see Descriptors.c). Over USB, that protocol goes:
+
+	host: 0x80 0x01             device: 0x81 0x01, controller type and MAC
+	host: 0x80 0x02             device: 0x81 0x02
+	host: 0x80 0x03             device: 0x81 0x03
+	host: 0x80 0x02             device: 0x81 0x02
+	host: 0x80 0x04             device: 0x30 input reports from now on
+
+after which the host asks for device info, reads the calibration in the SPI
+flash, turns on the IMU, player lights and so on with 0x01 subcommand reports,
+each answered by a 0x21 report in place of an input report. procon.py plays
+the host's part of all this against the firmware.
+
+Commands are taken one at a time, like the telemetry ones: the next one stays
+in the OUT bank, NAKed, until the answer to the last one is out. A host can
+also send them as SET_REPORT requests. The flash is
+a small image of the regions the Switch reads, holding a neutral factory
+calibration; everything else reads as erased, which also means there is no
+user calibration to apply over it.
+
+The reports the rest of the firmware builds are still HORI ones. They are
+turned into Pro Controller ones as they are sent, the sticks spread over the
+calibrated range.
+*/
+
+#include "ProController.h"
+
+#ifdef PRO_CONTROLLER
+
+#include "HID.h"
+
+// Battery full and charging, the controller powered from USB.
+#define PRO_CONNECTION        0x91
+// We have no rumble motor, so the vibrator input byte never changes.
+#define PRO_VIBRATOR          0x80
+// Controller type of the USB status answer and of the device info.
+#define PRO_TYPE              0x03
+
+// The three bytes of a stick position, two 12 bit axes.
+#define STICK_BYTES(X, Y)     (X) & 0xFF, ((X) >> 8) | (((Y) & 0x0F) << 4), (Y) >> 4
+
+// A MAC address from the range set aside for documentation (RFC 7042), as we have no Bluetooth radio to own one.
+static const uint8_t mac[6] PROGMEM = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x01 };
+
+// Answer to PRO_SUB_DEVICE_INFO: firmware 3.72, the controller type, the MAC, and colors taken from the SPI flash.
+static const uint8_t device_info_head[] PROGMEM = { 0x03, 0x48, PRO_TYPE, 0x02 };
+static const uint8_t device_info_tail[] PROGMEM = { 0x01, 0x01 };
+
+// Answer to PRO_SUB_MCU_CONFIG, as a real controller gives it, the CRC of the MCU data last.
+static const uint8_t mcu_config[] PROGMEM = { 0x01, 0x00, 0xFF, 0x00, 0x08, 0x00, 0x1B, 0x01 };
+#define MCU_CONFIG_CRC        0xC8
+#define MCU_CONFIG_CRC_OFFSET 33
+
+// SPI flash from 0x6020: IMU calibration (accelerometer and gyroscope origins and sensitivities), stick calibration
+// (the left stick's maximum, center and minimum, then the right stick's center, minimum and maximum), and colors
+// (body, buttons, left and right grips).
+static const uint8_t flash_6020[] PROGMEM = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x3B, 0x34, 0x3B, 0x34, 0x3B, 0x34,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	STICK_BYTES(PRO_STICK_RANGE, PRO_STICK_RANGE),
+	STICK_BYTES(PRO_STICK_CENTER, PRO_STICK_CENTER),
+	STICK_BYTES(PRO_STICK_RANGE, PRO_STICK_RANGE),
+	STICK_BYTES(PRO_STICK_CENTER, PRO_STICK_CENTER),
+	STICK_BYTES(PRO_STICK_RANGE, PRO_STICK_RANGE),
+	STICK_BYTES(PRO_STICK_RANGE, PRO_STICK_RANGE),
+	0xFF,
+	0x32, 0x32, 0x32,
+	0xFF, 0xFF, 0xFF,
+	0x32, 0x32, 0x32,
+	0x32, 0x32, 0x32
+};
+
+// SPI flash from 0x6080: IMU horizontal offsets, then the dead zone and range parameters of the left and right sticks.
+static const uint8_t flash_6080[] PROGMEM = {
+	0x50, 0xFD, 0x00, 0x00, 0xC6, 0x0F,
+	0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63,
+	0x0F, 0x30, 0x61, 0x96, 0x30, 0xF3, 0xD4, 0x14, 0x54, 0x41, 0x15, 0x54, 0xC7, 0x79, 0x9C, 0x33, 0x36, 0x63
+};
+
+typedef struct {
+	uint16_t       Address;
+	uint8_t        Length;
+	const uint8_t* Data;
+} FlashRegion_t;
+
+static const FlashRegion_t flash[] PROGMEM = {
+	{ 0x6020, sizeof(flash_6020), flash_6020 },
+	{ 0x6080, sizeof(flash_6080), flash_6080 }
+};
+
+// Where each button of JoystickButtons_t goes, in the order of its bits: the byte of Buttons, and the bit in it.
+static const uint8_t button_map[][2] PROGMEM = {
+	{ PRO_RIGHT,  PRO_RIGHT_Y },
+	{ PRO_RIGHT,  PRO_RIGHT_B },
+	{ PRO_RIGHT,  PRO_RIGHT_A },
+	{ PRO_RIGHT,  PRO_RIGHT_X },
+	{ PRO_LEFT,   PRO_LEFT_L },
+	{ PRO_RIGHT,  PRO_RIGHT_R },
+	{ PRO_LEFT,   PRO_LEFT_ZL },
+	{ PRO_RIGHT,  PRO_RIGHT_ZR },
+	{ PRO_SHARED, PRO_SHARED_MINUS },
+	{ PRO_SHARED, PRO_SHARED_PLUS },
+	{ PRO_SHARED, PRO_SHARED_LCLICK },
+	{ PRO_SHARED, PRO_SHARED_RCLICK },
+	{ PRO_SHARED, PRO_SHARED_HOME },
+	{ PRO_SHARED, PRO_SHARED_CAPTURE }
+};
+
+// The directional buttons of each HAT position, HAT_TOP to HAT_CENTER.
+static const uint8_t hat_map[] PROGMEM = {
+	PRO_LEFT_UP,
+	PRO_LEFT_UP | PRO_LEFT_RIGHT,
+	PRO_LEFT_RIGHT,
+	PRO_LEFT_DOWN | PRO_LEFT_RIGHT,
+	PRO_LEFT_DOWN,
+	PRO_LEFT_DOWN | PRO_LEFT_LEFT,
+	PRO_LEFT_LEFT,
+	PRO_LEFT_UP | PRO_LEFT_LEFT,
+	0
+};
+
+// Input state of the last report sent, repeated at the start of the answers to subcommands.
+static ProControllerInput_t state = {
+	.Connection = PRO_CONNECTION,
+	.LeftStick  = { STICK_BYTES(PRO_STICK_CENTER, PRO_STICK_CENTER) },
+	.RightStick = { STICK_BYTES(PRO_STICK_CENTER, PRO_STICK_CENTER) },
+	.Vibrator   = PRO_VIBRATOR
+};
+static uint8_t timer = 0;
+static bool started = false;
+
+static union {
+	ProControllerReport_t    Report;
+	ProControllerUSBAnswer_t USB;
+} answer;
+static bool answering = false;
+
+// One byte of the SPI flash image.
+static uint8_t ReadFlash(const uint32_t Address) {
+	for (uint8_t i = 0; i < sizeof(flash) / sizeof(flash[0]); i++)
+	{
+		const uint32_t offset = Address - pgm_read_word(&flash[i].Address);
+
+		if (offset < pgm_read_byte(&flash[i].Length))
+			return pgm_read_byte((const uint8_t*)pgm_read_word(&flash[i].Data) + offset);
+	}
+
+	// Erased flash.
+	return 0xFF;
+}
+
+static void USBCommand(const uint8_t Command) {
+	switch (Command)
+	{
+		case PRO_USB_STATUS:
+			// The MAC goes least significant byte first here.
+			answer.USB.Data[1] = PRO_TYPE;
+			for (uint8_t i = 0; i < sizeof(mac); i++)
+				answer.USB.Data[2 + i] = pgm_read_byte(&mac[sizeof(mac) - 1 - i]);
+			break;
+		case PRO_USB_HANDSHAKE:
+		case PRO_USB_BAUDRATE:
+			break;
+		case PRO_USB_START:
+			started = true;
+			return;
+		case PRO_USB_STOP:
+			started = false;
+			return;
+		default:
+			return;
+	}
+
+	answer.USB.ReportID = PRO_IN_USB;
+	answer.USB.Command = Command;
+	answering = true;
+}
+
+static void Subcommand(const uint8_t Command, const uint8_t* const Arguments) {
+	uint8_t* const data = answer.Report.Reply.Data;
+
+	answer.Report.Input.ReportID = PRO_IN_REPLY;
+	answer.Report.Reply.Subcommand = Command;
+	// A plain acknowledgement, unless the subcommand has data to answer with.
+	answer.Report.Reply.Ack = 0x80;
+
+	switch (Command)
+	{
+		case PRO_SUB_PAIRING:
+			answer.Report.Reply.Ack = 0x81;
+			data[0] = 0x03;
+			break;
+		case PRO_SUB_DEVICE_INFO:
+			answer.Report.Reply.Ack = 0x82;
+			memcpy_P(data, device_info_head, sizeof(device_info_head));
+			memcpy_P(data + sizeof(device_info_head), mac, sizeof(mac));
+			memcpy_P(data + sizeof(device_info_head) + sizeof(mac), device_info_tail, sizeof(device_info_tail));
+			break;
+		case PRO_SUB_TRIGGER_TIME:
+			// No trigger was ever held.
+			answer.Report.Reply.Ack = 0x83;
+			break;
+		case PRO_SUB_SPI_READ:
+		{
+			// Address (32 bits) and length in, the same followed by the bytes out.
+			const uint32_t address = Arguments[0] | ((uint16_t)Arguments[1] << 8) | ((uint32_t)Arguments[2] << 16) | ((uint32_t)Arguments[3] << 24);
+			uint8_t length = Arguments[4];
+
+			if (length > sizeof(answer.Report.Reply.Data) - 5)
+				length = sizeof(answer.Report.Reply.Data) - 5;
+
+			answer.Report.Reply.Ack = 0x90;
+			memcpy(data, Arguments, 5);
+			data[4] = length;
+			for (uint8_t i = 0; i < length; i++)
+				data[5 + i] = ReadFlash(address + i);
+			break;
+		}
+		case PRO_SUB_MCU_CONFIG:
+			answer.Report.Reply.Ack = 0xA0;
+			memcpy_P(data, mcu_config, sizeof(mcu_config));
+			data[MCU_CONFIG_CRC_OFFSET] = MCU_CONFIG_CRC;
+			break;
+	}
+
+	answering = true;
+}
+
+// Take the command waiting on the selected OUT endpoint or in a SET_REPORT request, unless the answer to the last one
+// hasn't been sent yet. Never waits.
+void ProController_ReadCommand(void) {
+	// Short commands leave the rest of it zero.
+	uint8_t command[PRO_COMMAND_SIZE] = { 0 };
+
+	if (answering)
+		return;
+	// Commands come on the OUT endpoint, or in SET_REPORT requests. With neither, the report ID stays 0, which isn't one.
+	if (Endpoint_IsOUTReceived())
+		HID_ReadReport(command, sizeof(command));
+	else
+		HID_TakeSetReport(command, sizeof(command));
+
+	memset(&answer, 0, sizeof(answer));
+	switch (command[0])
+	{
+		case PRO_OUT_USB:
+			USBCommand(command[1]);
+			break;
+		case PRO_OUT_SUBCOMMAND:
+			// After the packet counter and 8 bytes of rumble data.
+			Subcommand(command[10], &command[11]);
+			break;
+		// There's nothing to do with PRO_OUT_RUMBLE without a rumble motor.
+	}
+}
+
+// Fill in the input state at the start of a report about to be sent.
+static void WriteInput(ProControllerInput_t* const Input, const uint8_t ReportID) {
+	*Input = state;
+	Input->ReportID = ReportID;
+	Input->Timer = timer++;
+}
+
+// Send the answer to the last command on the selected IN endpoint, once HID_CanWriteReport() said it can take one.
+// Returns false when there was nothing to answer, and the endpoint is still free.
+bool ProController_WriteAnswer(void) {
+	if (!answering)
+		return false;
+
+	if (answer.Report.Input.ReportID == PRO_IN_REPLY)
+		WriteInput(&answer.Report.Input, PRO_IN_REPLY);
+	HID_WriteReport(&answer, sizeof(answer));
+	answering = false;
+	return true;
+}
+
+// Whether the host asked for input reports.
+bool ProController_IsStarted(void) {
+	return started;
+}
+
+// A stick position of the HORI report, Offset from its center, on the calibrated 12 bit scale.
+static uint16_t ScaleStick(const int16_t Offset) {
+	return PRO_STICK_CENTER + Offset * (PRO_STICK_RANGE / STICK_CENTER);
+}
+
+static void PackStick(uint8_t* const Bytes, const uint16_t X, const uint16_t Y) {
+	Bytes[0] = X & 0xFF;
+	Bytes[1] = (X >> 8) | (Y << 4);
+	Bytes[2] = Y >> 4;
+}
+
+// Send Report as the full input report on the selected IN endpoint, once HID_CanWriteReport() said it can take one.
+void ProController_WriteReport(const USB_JoystickReport_Input_t* const Report) {
+	ProControllerReport_t full;
+
+	memset(state.Buttons, 0, sizeof(state.Buttons));
+	for (uint8_t i = 0; i < sizeof(button_map) / sizeof(button_map[0]); i++)
+		if (Report->Button & (1 << i))
+			state.Buttons[pgm_read_byte(&button_map[i][0])] |= pgm_read_byte(&button_map[i][1]);
+	if (Report->HAT < sizeof(hat_map))
+		state.Buttons[PRO_LEFT] |= pgm_read_byte(&hat_map[Report->HAT]);
+
+	// The HORI report's Y axes grow downwards, the Pro Controller's upwards.
+	PackStick(state.LeftStick, ScaleStick(Report->LX - STICK_CENTER), ScaleStick(STICK_CENTER - Report->LY));
+	PackStick(state.RightStick, ScaleStick(Report->RX - STICK_CENTER), ScaleStick(STICK_CENTER - Report->RY));
+
+	memset(&full, 0, sizeof(full));
+	WriteInput(&full.Input, PRO_IN_FULL);
+	// Without an IMU, the controller lies still.
+	for (uint8_t i = 0; i < 3; i++)
+		full.IMU[i].Accel[2] = PRO_REST_ACCEL_Z;
+
+	HID_WriteReport(&full, sizeof(full));
+}
+
+#endif
@@ -0,0 +1,132 @@
+/** \file
+ *
+ *  Header file for ProController.c.
+ */
+
+#ifndef _PROCONTROLLER_H_
+#define _PROCONTROLLER_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Joystick.h"
+
+// Macros
+// Size of every report of the Pro Controller, both ways.
+#define PRO_REPORT_SIZE       JOYSTICK_EPSIZE
+// Bytes of OUT report the protocol reads: up to the arguments of the longest subcommand we answer.
+#define PRO_COMMAND_SIZE      16
+// Stick positions, 12 bits. The factory calibration in the SPI flash image puts the ends PRO_STICK_RANGE either side of center.
+#define PRO_STICK_CENTER      0x800
+#define PRO_STICK_RANGE       0x700
+// Accelerometer Z axis of a controller lying still: 1 G at the factory sensitivity of the SPI flash image.
+#define PRO_REST_ACCEL_Z      4096
+
+// Type Defines
+// Report IDs, first byte of every report.
+enum {
+	PRO_OUT_SUBCOMMAND   = 0x01, // Rumble and a subcommand, answered by PRO_IN_REPLY
+	PRO_OUT_RUMBLE       = 0x10, // Rumble only
+	PRO_OUT_USB          = 0x80, // A USB command, see below
+	PRO_IN_REPLY         = 0x21, // Input state, with the answer to a subcommand
+	PRO_IN_FULL          = 0x30, // Input state and IMU samples, the report sent at every poll
+	PRO_IN_USB           = 0x81  // Answer to a USB command
+};
+
+// USB commands, second byte of a PRO_OUT_USB report.
+enum {
+	PRO_USB_STATUS       = 0x01, // Answered with the controller type and MAC address
+	PRO_USB_HANDSHAKE    = 0x02,
+	PRO_USB_BAUDRATE     = 0x03, // Only means something on the UART of the real controller, acknowledged all the same
+	PRO_USB_START        = 0x04, // Send input reports from now on, without an answer
+	PRO_USB_STOP         = 0x05  // Stop them, without an answer
+};
+
+// Subcommands of a PRO_OUT_SUBCOMMAND report the Switch sends while connecting. Any other is acknowledged with no data.
+enum {
+	PRO_SUB_PAIRING      = 0x01,
+	PRO_SUB_DEVICE_INFO  = 0x02,
+	PRO_SUB_TRIGGER_TIME = 0x04,
+	PRO_SUB_SPI_READ     = 0x10,
+	PRO_SUB_MCU_CONFIG   = 0x21
+};
+
+// Bytes of ProControllerInput_t.Buttons.
+enum {
+	PRO_RIGHT,
+	PRO_SHARED,
+	PRO_LEFT
+};
+
+// Button bits in each of them.
+enum {
+	PRO_RIGHT_Y          = 0x01,
+	PRO_RIGHT_X          = 0x02,
+	PRO_RIGHT_B          = 0x04,
+	PRO_RIGHT_A          = 0x08,
+	PRO_RIGHT_R          = 0x40,
+	PRO_RIGHT_ZR         = 0x80,
+	PRO_SHARED_MINUS     = 0x01,
+	PRO_SHARED_PLUS      = 0x02,
+	PRO_SHARED_RCLICK    = 0x04,
+	PRO_SHARED_LCLICK    = 0x08,
+	PRO_SHARED_HOME      = 0x10,
+	PRO_SHARED_CAPTURE   = 0x20,
+	PRO_LEFT_DOWN        = 0x01,
+	PRO_LEFT_UP          = 0x02,
+	PRO_LEFT_RIGHT       = 0x04,
+	PRO_LEFT_LEFT        = 0x08,
+	PRO_LEFT_L           = 0x40,
+	PRO_LEFT_ZL          = 0x80
+};
+
+// Input state, at the start of PRO_IN_FULL and PRO_IN_REPLY reports.
+typedef struct {
+	uint8_t  ReportID;
+	uint8_t  Timer;          // Counts the reports sent
+	uint8_t  Connection;     // Battery level in the high nibble, connection in the low one
+	uint8_t  Buttons[3];     // Right, shared and left buttons
+	uint8_t  LeftStick[3];   // X and Y, 12 bits each, X first
+	uint8_t  RightStick[3];
+	uint8_t  Vibrator;
+} ATTR_PACKED ProControllerInput_t;
+
+typedef struct {
+	int16_t  Accel[3];
+	int16_t  Gyro[3];
+} ATTR_PACKED ProControllerIMU_t;
+
+typedef struct {
+	ProControllerInput_t Input;
+	union {
+		ProControllerIMU_t IMU[3];       // PRO_IN_FULL: the last three samples
+		struct {
+			uint8_t  Ack;                // Set high bit, with the type of data in the low bits
+			uint8_t  Subcommand;
+			uint8_t  Data[PRO_REPORT_SIZE - sizeof(ProControllerInput_t) - 2];
+		} ATTR_PACKED Reply;             // PRO_IN_REPLY
+		uint8_t  Data[PRO_REPORT_SIZE - sizeof(ProControllerInput_t)];
+	};
+} ATTR_PACKED ProControllerReport_t;
+
+// PRO_IN_USB, which has no input state.
+typedef struct {
+	uint8_t  ReportID;
+	uint8_t  Command;
+	uint8_t  Data[PRO_REPORT_SIZE - 2];
+} ATTR_PACKED ProControllerUSBAnswer_t;
+
+// Function Prototypes
+// Take the command waiting on the selected OUT endpoint or in a SET_REPORT request, unless the answer to the last one
+// hasn't been sent yet. Never waits.
+void ProController_ReadCommand(void);
+// Send the answer to the last command on the selected IN endpoint, once HID_CanWriteReport() said it can take one.
+// Returns false when there was nothing to answer, and the endpoint is still free.
+bool ProController_WriteAnswer(void);
+// Whether the host asked for input reports.
+bool ProController_IsStarted(void);
+// Send Report as the full input report on the selected IN endpoint, once HID_CanWriteReport() said it can take one.
+void ProController_WriteReport(const USB_JoystickReport_Input_t* const Report);
+
+#endif
@@ -0,0 +1,124 @@
+/*
+Fixed rate key matrix scanning.
+
+Scanned from the main loop, the matrix was sampled whenever the loop came
+round again, after however long HID_Task() and USB_USBTask() took, and the
+debouncing counters counted samples of uneven length. Timer 1 now fires
+SCAN_RATE_HZ times a second and the firmware scans from its compare
+interrupt, so a change is debounced in DEBOUNCE_MS (as many periods as that
+takes) and an eager press waits one period at most, whatever the main loop
+does.
+
+What is left of the timing is how long the interrupt waits to run: the USB
+interrupt holds it up, and control requests are answered from there. The
+timer counts CPU cycles from 0 again at every compare match, so its count as
+the scan starts is that wait. The shortest and longest waits and the longest
+scan are kept until scanjitter.py asks for them, as is the count of scans
+that started so late that the timer had fired again, one scan being lost.
+*/
+
+#include "ScanTimer.h"
+
+#define SCAN_PERIOD (F_CPU / SCAN_RATE_HZ)
+#if SCAN_PERIOD > 65535 || SCAN_PERIOD < 1000
+#error "SCAN_RATE_HZ out of the range of Timer 1 without a prescaler, or too fast to scan"
+#endif
+
+// Written by the scan's interrupt, and read and reset by the control request's. The USB interrupt enables interrupts
+// again before it hands out control requests, so the scan can run in the middle of one.
+static uint16_t scans = 0;
+static uint16_t late = 0;
+static uint16_t min_latency = UINT16_MAX;
+static uint16_t max_latency = 0;
+static uint16_t max_duration = 0;
+static uint16_t started = 0;
+// The first scan after a SCAN_REQ_STATUS may have waited on the request, and isn't counted.
+static bool skip = true;
+
+// Start the timer; its compare interrupt fires SCAN_RATE_HZ times a second from then on.
+void ScanTimer_Init(void) {
+	// CTC mode on OCR1A, counting CPU cycles.
+	TCCR1A = 0;
+	TCCR1B = 0;
+	TCNT1 = 0;
+	OCR1A = SCAN_PERIOD - 1;
+	TIFR1 = (1 << OCF1A);
+	TIMSK1 = (1 << OCIE1A);
+	TCCR1B = (1 << WGM12) | (1 << CS10);
+}
+
+// Call first thing in the compare interrupt, before the scan.
+void ScanTimer_Start(void) {
+	started = TCNT1;
+
+	if (skip)
+		return;
+
+	scans++;
+	// The flag was cleared as the interrupt started. Set again, the timer fired while this scan waited: the count
+	// restarted, and says nothing of the wait.
+	if (TIFR1 & (1 << OCF1A))
+	{
+		late++;
+		return;
+	}
+	if (started < min_latency)
+		min_latency = started;
+	if (started > max_latency)
+		max_latency = started;
+}
+
+// Call last thing in the compare interrupt, after the scan.
+void ScanTimer_End(void) {
+	const uint16_t now = TCNT1;
+	uint16_t duration = now - started;
+
+	// The count restarted if the scan ran past the next compare match.
+	if (now < started)
+		duration += SCAN_PERIOD;
+
+	if (skip)
+	{
+		skip = false;
+		return;
+	}
+
+	if (duration > max_duration)
+		max_duration = duration;
+}
+
+// Answer the vendor request of scanjitter.py, from the control request event.
+void ScanTimer_ControlRequest(void) {
+	const uint8_t type = USB_ControlRequest.bmRequestType;
+
+	if ((type & (CONTROL_REQTYPE_TYPE | CONTROL_REQTYPE_RECIPIENT)) != (REQTYPE_VENDOR | REQREC_DEVICE) ||
+	    USB_ControlRequest.bRequest != SCAN_REQ_STATUS || !(type & REQDIR_DEVICETOHOST))
+		return;
+
+	ScanStatus_t status;
+
+	// Take the counts and start them over in one go, so a scan can't land between the two.
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		status = (ScanStatus_t){
+			.RateHz      = SCAN_RATE_HZ,
+			.Period      = SCAN_PERIOD,
+			.Scans       = scans,
+			.Late        = late,
+			.MinLatency  = min_latency,
+			.MaxLatency  = max_latency,
+			.MaxDuration = max_duration
+		};
+
+		scans = 0;
+		late = 0;
+		min_latency = UINT16_MAX;
+		max_latency = 0;
+		max_duration = 0;
+		skip = true;
+	}
+
+	Endpoint_ClearSETUP();
+	Endpoint_Write_Control_Stream_LE(&status, sizeof(status));
+	Endpoint_ClearOUT();
+}
@@ -0,0 +1,48 @@
+/** \file
+ *
+ *  Header file for ScanTimer.c.
+ */
+
+#ifndef _SCANTIMER_H_
+#define _SCANTIMER_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Joystick.h"
+
+// Macros
+// Scans of the key matrix per second. Each is a sample of the debouncing counters (see Debounce.h), which take as many
+// as fit in the DEBOUNCE_MS window, DEBOUNCE_MAX_SAMPLES at most.
+#ifndef SCAN_RATE_HZ
+#define SCAN_RATE_HZ 2000
+#endif
+
+// Type Defines
+// Vendor requests to the device, sent by scanjitter.py. They follow the requests of Stream.h.
+enum {
+	SCAN_REQ_STATUS = 0x09 // IN, ScanStatus_t, starting the counts over
+};
+
+// Timing of the scans since the last SCAN_REQ_STATUS. Times are in counts of the timer, CPU cycles.
+typedef struct {
+	uint16_t RateHz;      // SCAN_RATE_HZ
+	uint16_t Period;      // Counts between two scans
+	uint16_t Scans;
+	uint16_t Late;        // Scans that started a whole period late or more, so that one was lost
+	uint16_t MinLatency;  // Shortest and longest time from the timer firing to a scan starting, the others
+	uint16_t MaxLatency;
+	uint16_t MaxDuration; // Longest scan
+} ATTR_PACKED ScanStatus_t;
+
+// Function Prototypes
+// Start the timer; its compare interrupt fires SCAN_RATE_HZ times a second from then on.
+void ScanTimer_Init(void);
+// Call first and last thing in the compare interrupt, around the scan, to time it.
+void ScanTimer_Start(void);
+void ScanTimer_End(void);
+// Answer the vendor request of scanjitter.py, from the control request event.
+void ScanTimer_ControlRequest(void);
+
+#endif
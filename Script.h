@@ -0,0 +1,136 @@
+/** \file
+ *
+ *  Packed command stream format for the scripted firmware (Joystick.c), run by Sequencer.c.
+ *
+ *  A script lives entirely in flash as a flat byte stream. Each command is one
+ *  button byte followed by its duration in milliseconds as a little-endian
+ *  base-128 varint: durations below 128 take a single byte, longer ones take
+ *  two (up to 16383).
+ *
+ *  Command bytes from 0x80 up are control opcodes instead of buttons. They take
+ *  no time of their own and let a script repeat blocks, call shared subroutines
+ *  and mark the point it loops back to once it reaches its end. The exception
+ *  are the stick opcodes, timed commands that hold a stick at any position or
+ *  sweep it between two positions.
+ *
+ *  A script has up to four tracks, each its own command stream with its own
+ *  timeline. The inputs of all tracks are merged into every report, so a stick
+ *  movement can overlap button presses. Tracks are named after what they
+ *  usually drive, but any input may be used on any of them.
+ */
+
+#ifndef _SCRIPT_H_
+#define _SCRIPT_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// Type Defines
+// Enumeration for the scripted inputs. Stored as a single byte in the stream.
+typedef enum {
+	UP,
+	DOWN,
+	LEFT,
+	RIGHT,
+	X,
+	Y,
+	A,
+	B,
+	L,
+	R,
+	THROW,
+	NOTHING,
+	TRIGGERS,
+	ZL,
+	ZR,
+	MINUS,
+	PLUS,
+	LCLICK,
+	RCLICK,
+	HOME,
+	CAPTURE,
+	R_UP,
+	R_DOWN,
+	R_LEFT,
+	R_RIGHT,
+	DPAD_UP,
+	DPAD_DOWN,
+	DPAD_LEFT,
+	DPAD_RIGHT
+} Buttons_t;
+
+// Enumeration for the tracks of a script.
+enum {
+	TRACK_BUTTONS,
+	TRACK_LEFT_STICK,
+	TRACK_RIGHT_STICK,
+	TRACK_HAT,
+	SCRIPT_TRACKS
+};
+
+// Enumeration for the control opcodes, sharing the command byte with Buttons_t.
+enum {
+	OP_REPEAT = 0x80, // Followed by a count; runs the block up to OP_END_REPEAT that many times
+	OP_END_REPEAT,
+	OP_CALL,          // Followed by a subroutine index; runs that subroutine up to its OP_RETURN
+	OP_RETURN,
+	OP_LOOP_POINT,    // Marks where the track resumes after OP_END_SCRIPT
+	OP_END_SCRIPT,    // Waits for every track to get here, then jumps back to the loop point (or the start)
+	OP_LSTICK,        // Followed by x, y and a duration; holds the left stick there
+	OP_RSTICK,        // Same for the right stick
+	OP_LRAMP,         // Followed by x0, y0, x1, y1, the per-millisecond x and y rates and a duration; sweeps the left stick
+	OP_RRAMP          // Same for the right stick
+};
+
+// A script and the subroutines its OP_CALLs refer to. Kept in flash, or in EEPROM
+// once uploaded, where every pointer is instead an offset from the start of the
+// Script_t, zero for none.
+typedef struct {
+	const uint8_t*        Tracks[SCRIPT_TRACKS]; // Command stream of each track, NULL for an unused track
+	const uint8_t* const* Subroutines;           // Flash table of command streams, indexed by the OP_CALL operand
+	const char*           Name;                  // Flash string naming the script
+	uint8_t               SubroutineCount;       // Entries in Subroutines; an OP_CALL past them restarts the track
+} Script_t;
+
+// Macros
+// Fails the build if a constant does not satisfy the given condition, evaluates to zero otherwise.
+#define SCRIPT_CHECK(cond) (0 * sizeof(char[(cond) ? 1 : -1]))
+
+// Varint durations in their one byte (below 128) and two byte (below 16384) forms.
+#define SCRIPT_DURATION(duration) \
+	((duration) + SCRIPT_CHECK((duration) < 128))
+#define SCRIPT_DURATION_LONG(duration) \
+	(0x80 | ((duration) & 0x7F)), (((duration) >> 7) + SCRIPT_CHECK((duration) < 16384))
+
+// A command whose duration fits in one varint byte (below 128).
+#define STEP(button, duration)      (button), SCRIPT_DURATION(duration)
+
+// A command whose duration needs two varint bytes (below 16384).
+#define STEP_LONG(button, duration) (button), SCRIPT_DURATION_LONG(duration)
+
+// Hold a stick at (x, y) for the duration.
+#define LSTICK(x, y, duration)      OP_LSTICK, (x), (y), SCRIPT_DURATION_LONG(duration)
+#define RSTICK(x, y, duration)      OP_RSTICK, (x), (y), SCRIPT_DURATION_LONG(duration)
+
+// Sweep a stick from (x0, y0) to (x1, y1) over the duration (at least 2 ms).
+// The per-millisecond rates are worked out here, in 8.8 fixed point, so the firmware never divides.
+#define SCRIPT_RAMP_RATE(from, to, duration) \
+	(((((to) - (from)) * 256) + ((to) >= (from) ? (duration) / 2 : -((duration) / 2))) / (duration) + SCRIPT_CHECK((duration) >= 2))
+#define SCRIPT_WORD(value)          ((value) & 0xFF), (((value) >> 8) & 0xFF)
+#define SCRIPT_RAMP(x0, y0, x1, y1, duration) \
+	(x0), (y0), (x1), (y1), \
+	SCRIPT_WORD(SCRIPT_RAMP_RATE(x0, x1, duration)), SCRIPT_WORD(SCRIPT_RAMP_RATE(y0, y1, duration)), \
+	SCRIPT_DURATION_LONG(duration)
+#define LRAMP(x0, y0, x1, y1, duration) OP_LRAMP, SCRIPT_RAMP(x0, y0, x1, y1, duration)
+#define RRAMP(x0, y0, x1, y1, duration) OP_RRAMP, SCRIPT_RAMP(x0, y0, x1, y1, duration)
+
+// Control flow. Nesting of REPEAT blocks and CALLs is limited to SEQUENCER_STACK_DEPTH.
+#define REPEAT(count)     OP_REPEAT, ((count) + SCRIPT_CHECK((count) > 0 && (count) < 256))
+#define END_REPEAT        OP_END_REPEAT
+#define CALL(subroutine)  OP_CALL, (subroutine)
+#define RETURN            OP_RETURN
+#define LOOP_POINT        OP_LOOP_POINT
+#define END_SCRIPT        OP_END_SCRIPT
+
+#endif
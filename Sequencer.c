@@ -0,0 +1,470 @@
+/*
+Command sequencer for the scripted firmwares.
+
+Walks the packed command streams of a script (see Script.h) one tick at a time.
+Control opcodes are resolved when a command runs out, so each tick costs a
+handful of flash reads at most, and the REPEAT/CALL frames live on a small
+fixed stack per track.
+
+Durations are in milliseconds, so the caller reports how much time passed
+since the previous tick rather than the sequencer counting polls. A gap that
+is too long to be a poll interval is a host stall, and is not counted.
+
+Every track has its own cursor and timeline. The report is rebuilt from the
+inputs of all tracks only when one of them moves on to a different input.
+
+Stick ramps are integrated in 8.8 fixed point. The per-millisecond rates are
+computed when the script is built, so a tick only adds rate * elapsed. The
+rates are rounded, so a ramp is put at its end when its time runs out.
+
+A script uploaded over USB (see Upload.c) is run in place from EEPROM. Its
+Script_t holds offsets from its own start instead of pointers, and all script
+reads go through ReadByte/ReadPointer to reach the right memory.
+*/
+
+#include "Sequencer.h"
+
+enum {
+	NO_STICK,
+	LEFT_STICK,
+	RIGHT_STICK
+};
+
+// Report for each scripted input, merged into the report we send.
+#define INPUT_REPORT(button, hat, lx, ly, rx, ry) \
+	{ .Button = (button), .HAT = (hat), .LX = (lx), .LY = (ly), .RX = (rx), .RY = (ry), .VendorSpec = 0 }
+#define BUTTON_REPORT(button) \
+	INPUT_REPORT(button, HAT_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER)
+
+static const USB_JoystickReport_Input_t input_reports[] PROGMEM = {
+	[UP]         = INPUT_REPORT(0,        HAT_CENTER, STICK_CENTER, STICK_MIN,    STICK_CENTER, STICK_CENTER),
+	[DOWN]       = INPUT_REPORT(0,        HAT_CENTER, STICK_CENTER, STICK_MAX,    STICK_CENTER, STICK_CENTER),
+	[LEFT]       = INPUT_REPORT(0,        HAT_CENTER, STICK_MIN,    STICK_CENTER, STICK_CENTER, STICK_CENTER),
+	[RIGHT]      = INPUT_REPORT(0,        HAT_CENTER, STICK_MAX,    STICK_CENTER, STICK_CENTER, STICK_CENTER),
+	[X]          = BUTTON_REPORT(SWITCH_X),
+	[Y]          = BUTTON_REPORT(SWITCH_Y),
+	[A]          = BUTTON_REPORT(SWITCH_A),
+	[B]          = BUTTON_REPORT(SWITCH_B),
+	[L]          = BUTTON_REPORT(SWITCH_L),
+	[R]          = BUTTON_REPORT(SWITCH_R),
+	[THROW]      = INPUT_REPORT(SWITCH_R, HAT_CENTER, STICK_CENTER, STICK_MIN,    STICK_CENTER, STICK_CENTER),
+	[NOTHING]    = BUTTON_REPORT(0),
+	[TRIGGERS]   = BUTTON_REPORT(SWITCH_L | SWITCH_R),
+	[ZL]         = BUTTON_REPORT(SWITCH_ZL),
+	[ZR]         = BUTTON_REPORT(SWITCH_ZR),
+	[MINUS]      = BUTTON_REPORT(SWITCH_MINUS),
+	[PLUS]       = BUTTON_REPORT(SWITCH_PLUS),
+	[LCLICK]     = BUTTON_REPORT(SWITCH_LCLICK),
+	[RCLICK]     = BUTTON_REPORT(SWITCH_RCLICK),
+	[HOME]       = BUTTON_REPORT(SWITCH_HOME),
+	[CAPTURE]    = BUTTON_REPORT(SWITCH_CAPTURE),
+	[R_UP]       = INPUT_REPORT(0,        HAT_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_MIN),
+	[R_DOWN]     = INPUT_REPORT(0,        HAT_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_MAX),
+	[R_LEFT]     = INPUT_REPORT(0,        HAT_CENTER, STICK_CENTER, STICK_CENTER, STICK_MIN,    STICK_CENTER),
+	[R_RIGHT]    = INPUT_REPORT(0,        HAT_CENTER, STICK_CENTER, STICK_CENTER, STICK_MAX,    STICK_CENTER),
+	[DPAD_UP]    = INPUT_REPORT(0,        HAT_TOP,    STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER),
+	[DPAD_DOWN]  = INPUT_REPORT(0,        HAT_BOTTOM, STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER),
+	[DPAD_LEFT]  = INPUT_REPORT(0,        HAT_LEFT,   STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER),
+	[DPAD_RIGHT] = INPUT_REPORT(0,        HAT_RIGHT,  STICK_CENTER, STICK_CENTER, STICK_CENTER, STICK_CENTER),
+};
+
+// Command bytes below this are inputs. The rest of the bytes below OP_REPEAT mean nothing.
+#define INPUT_COUNT (sizeof(input_reports) / sizeof(input_reports[0]))
+
+// Instance the public functions work on, set as they are entered so the helpers below needn't all be passed it.
+static Sequencer_t* sequencer;
+
+// Read a byte of the script, from flash or EEPROM.
+static uint8_t ReadByte(const uint8_t* const address) {
+	return sequencer->Image ? eeprom_read_byte(address) : pgm_read_byte(address);
+}
+
+// Read a pointer of the script. In EEPROM it is an offset from the start of the script, zero for none.
+static const uint8_t* ReadPointer(const uint8_t* const* const address) {
+	uint16_t offset;
+
+	if (sequencer->Image == NULL)
+		return (const uint8_t*)pgm_read_word(address);
+
+	offset = eeprom_read_word((const uint16_t*)address);
+	return offset ? sequencer->Image + offset : NULL;
+}
+
+// Decode the varint duration at the cursor, leaving the cursor after it.
+static uint16_t ReadDuration(const uint8_t** const cursor) {
+	uint16_t duration = ReadByte((*cursor)++);
+
+	if (duration & 0x80)
+		duration = (duration & 0x7F) | ((uint16_t)ReadByte((*cursor)++) << 7);
+
+	return duration;
+}
+
+// Look up a subroutine in the script's table, NULL if the script has no such subroutine.
+static const uint8_t* Subroutine(const uint8_t index) {
+	const uint8_t* const* table = (const uint8_t* const*)ReadPointer((const uint8_t* const*)&sequencer->Script->Subroutines);
+
+	if (table == NULL || index >= ReadByte(&sequencer->Script->SubroutineCount))
+		return NULL;
+
+	return ReadPointer(&table[index]);
+}
+
+// Go back to the loop point with an empty stack. Also our way out of a malformed script.
+static void Restart(Track_t* const track) {
+	track->Depth = 0;
+	track->Cursor = track->LoopPoint;
+	track->Waiting = false;
+}
+
+// Decode a stick command: where the stick starts and, for a ramp, where it ends and how fast it gets there.
+static void LoadStick(Track_t* const track, const uint8_t op) {
+	const uint8_t* const cursor = track->Cursor;
+
+	track->Button = NOTHING;
+	track->Stick = (op == OP_LSTICK || op == OP_LRAMP) ? LEFT_STICK : RIGHT_STICK;
+	// Start half a unit in, so dropping the fraction rounds to nearest.
+	track->X = ((uint16_t)ReadByte(&cursor[0]) << 8) | 0x80;
+	track->Y = ((uint16_t)ReadByte(&cursor[1]) << 8) | 0x80;
+	track->RateX = 0;
+	track->RateY = 0;
+	// A hold ends where it starts.
+	track->ToX = ReadByte(&cursor[0]);
+	track->ToY = ReadByte(&cursor[1]);
+	track->Cursor += 2;
+
+	if (op == OP_LRAMP || op == OP_RRAMP)
+	{
+		track->ToX = ReadByte(&cursor[2]);
+		track->ToY = ReadByte(&cursor[3]);
+		track->RateX = ReadByte(&cursor[4]) | ((uint16_t)ReadByte(&cursor[5]) << 8);
+		track->RateY = ReadByte(&cursor[6]) | ((uint16_t)ReadByte(&cursor[7]) << 8);
+		track->Cursor += 6;
+	}
+
+	track->Duration = ReadDuration(&track->Cursor);
+}
+
+// Move one axis of a ramp on by the elapsed milliseconds, stopping at its end. Returns whether the reported value changed.
+static bool Sweep(uint16_t* const axis, const int16_t rate, const uint8_t to, const uint16_t elapsed) {
+	const uint8_t before = *axis >> 8;
+	const int32_t end = ((uint16_t)to << 8) | 0x80;
+	int32_t position;
+
+	if (rate == 0)
+		return false;
+
+	position = (int32_t)*axis + (int32_t)rate * elapsed;
+	if ((rate > 0 && position > end) || (rate < 0 && position < end))
+		position = end;
+
+	*axis = position;
+	return (*axis >> 8) != before;
+}
+
+// Put the stick of a ramp that ran out at the ramp's end, if its rounded rates fell short of it. Returns whether it moved.
+static bool Finish(Track_t* const track) {
+	if (track->Stick == NO_STICK || ((track->X >> 8) == track->ToX && (track->Y >> 8) == track->ToY))
+		return false;
+
+	track->X = ((uint16_t)track->ToX << 8) | 0x80;
+	track->Y = ((uint16_t)track->ToY << 8) | 0x80;
+	return true;
+}
+
+// Run control opcodes until the next command of the track is loaded.
+static void Fetch(Track_t* const track) {
+	for (uint8_t ops = 0; ops < SEQUENCER_MAX_OPS; ops++)
+	{
+		const uint8_t op = ReadByte(track->Cursor++);
+
+		if (op < INPUT_COUNT)
+		{
+			track->Button = op;
+			track->Stick = NO_STICK;
+			track->Duration = ReadDuration(&track->Cursor);
+			return;
+		}
+
+		switch (op)
+		{
+			case OP_REPEAT:
+				if (track->Depth == SEQUENCER_STACK_DEPTH)
+				{
+					Restart(track);
+					break;
+				}
+				track->Stack[track->Depth].Count = ReadByte(track->Cursor++);
+				track->Stack[track->Depth].Return = track->Cursor;
+				track->Depth++;
+				break;
+
+			case OP_END_REPEAT:
+				if (track->Depth == 0)
+					Restart(track);
+				else if (--track->Stack[track->Depth - 1].Count)
+					track->Cursor = track->Stack[track->Depth - 1].Return;
+				else
+					track->Depth--;
+				break;
+
+			case OP_CALL:
+			{
+				const uint8_t* const subroutine = Subroutine(ReadByte(track->Cursor));
+
+				if (track->Depth == SEQUENCER_STACK_DEPTH || subroutine == NULL)
+				{
+					Restart(track);
+					break;
+				}
+				track->Stack[track->Depth].Count = 0;
+				track->Stack[track->Depth].Return = track->Cursor + 1;
+				track->Depth++;
+				track->Cursor = subroutine;
+				break;
+			}
+
+			case OP_RETURN:
+				if (track->Depth == 0)
+					Restart(track);
+				else
+					track->Cursor = track->Stack[--track->Depth].Return;
+				break;
+
+			case OP_LOOP_POINT:
+				track->LoopPoint = track->Cursor;
+				break;
+
+			case OP_END_SCRIPT:
+				// Hold still at the end until all tracks are here; Sequencer_Tick loops them back together.
+				track->Waiting = true;
+				track->Button = NOTHING;
+				track->Stick = NO_STICK;
+				track->Duration = 0;
+				return;
+
+			case OP_LSTICK:
+			case OP_RSTICK:
+			case OP_LRAMP:
+			case OP_RRAMP:
+				LoadStick(track, op);
+				return;
+
+			default:
+				Restart(track);
+				break;
+		}
+	}
+
+	// Too many opcodes without a command in between; idle for a tick and carry on from here next time.
+	track->Button = NOTHING;
+	track->Stick = NO_STICK;
+	track->Duration = 0;
+}
+
+// Fetch the next command of the track, keeping any overshoot of the previous one.
+static void Advance(Track_t* const track) {
+	Fetch(track);
+	track->Remaining += track->Duration;
+}
+
+// Rebuild the report from the current input of every track.
+static void Merge(void) {
+	USB_JoystickReport_Input_t* const report = &sequencer->Report;
+
+	*report = (USB_JoystickReport_Input_t)BUTTON_REPORT(0);
+
+	for (Track_t* track = sequencer->Tracks; track < sequencer->Tracks + SCRIPT_TRACKS; track++)
+	{
+		if (track->Cursor == NULL)
+			continue;
+
+		const USB_JoystickReport_Input_t* const input = &input_reports[track->Button];
+		const uint8_t hat = pgm_read_byte(&input->HAT);
+		uint8_t lx = pgm_read_byte(&input->LX);
+		uint8_t ly = pgm_read_byte(&input->LY);
+		uint8_t rx = pgm_read_byte(&input->RX);
+		uint8_t ry = pgm_read_byte(&input->RY);
+
+		if (track->Stick == LEFT_STICK)
+		{
+			lx = track->X >> 8;
+			ly = track->Y >> 8;
+		}
+		else if (track->Stick == RIGHT_STICK)
+		{
+			rx = track->X >> 8;
+			ry = track->Y >> 8;
+		}
+
+		report->Button |= pgm_read_word(&input->Button);
+		if (hat != HAT_CENTER)
+			report->HAT = hat;
+		if (lx != STICK_CENTER)
+			report->LX = lx;
+		if (ly != STICK_CENTER)
+			report->LY = ly;
+		if (rx != STICK_CENTER)
+			report->RX = rx;
+		if (ry != STICK_CENTER)
+			report->RY = ry;
+	}
+}
+
+// Start running the script from its first command.
+static void Load(const Script_t* const Script) {
+	sequencer->Script = Script;
+	sequencer->LoopCount = 0;
+
+	for (uint8_t i = 0; i < SCRIPT_TRACKS; i++)
+	{
+		Track_t* const track = &sequencer->Tracks[i];
+
+		track->Cursor = ReadPointer(&Script->Tracks[i]);
+		track->LoopPoint = track->Cursor;
+		track->Depth = 0;
+		track->Waiting = false;
+		track->Button = NOTHING;
+		track->Stick = NO_STICK;
+		track->Remaining = 0;
+
+		if (track->Cursor)
+			Advance(track);
+	}
+
+	Merge();
+}
+
+// Start running a script in flash from its first command.
+void Sequencer_Start(Sequencer_t* const Sequencer, const Script_t* const Script) {
+	sequencer = Sequencer;
+	sequencer->Image = NULL;
+	Load(Script);
+}
+
+// Start running a script uploaded to EEPROM from its first command.
+void Sequencer_StartEEPROM(Sequencer_t* const Sequencer, const Script_t* const Script) {
+	sequencer = Sequencer;
+	sequencer->Image = (const uint8_t*)Script;
+	Load(Script);
+}
+
+// Advance the script by the milliseconds elapsed since the last tick and return the report to send now.
+const USB_JoystickReport_Input_t* Sequencer_Tick(Sequencer_t* const Sequencer, const uint16_t Elapsed) {
+	Track_t* const tracks = Sequencer->Tracks;
+	bool changed = false;
+	uint8_t active = 0;
+	uint8_t waiting = 0;
+
+	sequencer = Sequencer;
+
+	// The host went away for a while and nothing we sent in the meantime was seen.
+	// Freeze the script through the stall so it resumes exactly where it left off.
+	if (Elapsed > SEQUENCER_STALL_MS)
+	{
+		Sequencer->StallCount++;
+		return &Sequencer->Report;
+	}
+
+	for (Track_t* track = tracks; track < tracks + SCRIPT_TRACKS; track++)
+	{
+		if (track->Cursor == NULL)
+			continue;
+
+		// A waiting track keeps counting down, so it knows how long ago it reached the end.
+		track->Remaining -= Elapsed;
+
+		if (!track->Waiting)
+		{
+			// We move on by at most one command per tick, so a command shorter than the poll interval still
+			// reaches the host. Any overshoot is carried into the next command to keep the script on time.
+			// A ramp that ran out short of its end is first shown there for a tick.
+			if (track->Remaining <= 0 && Finish(track))
+				changed = true;
+			else if (track->Remaining <= 0)
+			{
+				const Buttons_t previous = track->Button;
+				const uint8_t previous_stick = track->Stick;
+
+				Advance(track);
+				changed |= (track->Button != previous || track->Stick != NO_STICK || previous_stick != NO_STICK);
+			}
+			else if (track->Stick != NO_STICK)
+			{
+				changed |= Sweep(&track->X, track->RateX, track->ToX, Elapsed);
+				changed |= Sweep(&track->Y, track->RateY, track->ToY, Elapsed);
+			}
+		}
+
+		active++;
+		if (track->Waiting)
+			waiting++;
+	}
+
+	// Every track reached the end of the script: loop them all back in step. The loop started when the last of them
+	// got there, and the time since is carried into every track like the overshoot of any other command.
+	if (active && waiting == active)
+	{
+		int32_t overshoot = INT32_MIN;
+
+		for (Track_t* track = tracks; track < tracks + SCRIPT_TRACKS; track++)
+		{
+			if (track->Cursor != NULL && track->Remaining > overshoot)
+				overshoot = track->Remaining;
+		}
+
+		for (Track_t* track = tracks; track < tracks + SCRIPT_TRACKS; track++)
+		{
+			if (track->Cursor == NULL)
+				continue;
+
+			track->Remaining = overshoot;
+			Restart(track);
+			Advance(track);
+		}
+		Sequencer->LoopCount++;
+		changed = true;
+	}
+
+	if (changed)
+		Merge();
+
+	return &Sequencer->Report;
+}
+
+// The report as of the last tick.
+const USB_JoystickReport_Input_t* Sequencer_GetReport(const Sequencer_t* const Sequencer) {
+	return &Sequencer->Report;
+}
+
+// Number of host stalls the script was frozen through.
+uint16_t Sequencer_GetStallCount(const Sequencer_t* const Sequencer) {
+	return Sequencer->StallCount;
+}
+
+// Times the script went back to its loop point since it started.
+uint16_t Sequencer_GetLoopCount(const Sequencer_t* const Sequencer) {
+	return Sequencer->LoopCount;
+}
+
+// Offset of the next command of a track from the start of its stream, 0xFFFF if the script doesn't use it.
+// Inside a subroutine, that's the command after the outermost CALL.
+uint16_t Sequencer_GetPosition(Sequencer_t* const Sequencer, const uint8_t Track) {
+	const Track_t* const track = &Sequencer->Tracks[Track];
+	const uint8_t* cursor = track->Cursor;
+
+	sequencer = Sequencer;
+	if (cursor == NULL)
+		return 0xFFFF;
+
+	for (uint8_t i = 0; i < track->Depth; i++)
+	{
+		if (track->Stack[i].Count == 0)
+		{
+			cursor = track->Stack[i].Return;
+			break;
+		}
+	}
+
+	return cursor - ReadPointer(&Sequencer->Script->Tracks[Track]);
+}
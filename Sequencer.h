@@ -0,0 +1,79 @@
+/** \file
+ *
+ *  Header file for Sequencer.c.
+ */
+
+#ifndef _SEQUENCER_H_
+#define _SEQUENCER_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/pgmspace.h>
+#include <avr/eeprom.h>
+
+#include "Joystick.h"
+#include "Script.h"
+
+// Macros
+// Maximum nesting of REPEAT blocks and CALLs, per track.
+#define SEQUENCER_STACK_DEPTH 4
+// Control opcodes run back to back before the sequencer gives up on a tick, keeping each tick bounded.
+#define SEQUENCER_MAX_OPS     8
+// A gap between ticks longer than this means the host stopped polling us (bus suspend, HDMI re-sync in dock mode...).
+#define SEQUENCER_STALL_MS    100
+
+// Type Defines
+// A REPEAT block or CALL in progress.
+typedef struct {
+	const uint8_t* Return; // Block start for a REPEAT, call site for a CALL
+	uint8_t        Count;  // Iterations left for a REPEAT, 0 for a CALL
+} Frame_t;
+
+// Where one track of the script is at.
+typedef struct {
+	const uint8_t* Cursor;    // Next byte to fetch, NULL if the script doesn't use this track
+	const uint8_t* LoopPoint;
+	Frame_t        Stack[SEQUENCER_STACK_DEPTH];
+	uint8_t        Depth;
+	Buttons_t      Button;
+	uint16_t       Duration;
+	int32_t        Remaining; // Milliseconds left on the current command. Negative when running behind the script, or since reaching the end.
+	bool           Waiting;   // Reached OP_END_SCRIPT, waiting for the other tracks to get there
+	uint8_t        Stick;     // Stick positioned by a stick command, NO_STICK for a button command
+	uint16_t       X;         // Stick position, 8.8 fixed point
+	uint16_t       Y;
+	int16_t        RateX;     // Change per millisecond while ramping, 8.8 fixed point
+	int16_t        RateY;
+	uint8_t        ToX;       // Where the ramp ends, or where the stick is held
+	uint8_t        ToY;
+} Track_t;
+
+// One running script. A firmware can run several side by side, one per controller.
+typedef struct {
+	const Script_t*            Script;
+	const uint8_t*             Image;      // Start of the script in EEPROM, NULL when it runs from flash
+	Track_t                    Tracks[SCRIPT_TRACKS];
+	USB_JoystickReport_Input_t Report;
+	uint16_t                   StallCount;
+	uint16_t                   LoopCount;
+} Sequencer_t;
+
+// Function Prototypes
+// Start running a script in flash from its first command.
+void Sequencer_Start(Sequencer_t* const Sequencer, const Script_t* const Script);
+// Start running a script uploaded to EEPROM from its first command.
+void Sequencer_StartEEPROM(Sequencer_t* const Sequencer, const Script_t* const Script);
+// Advance the script by the milliseconds elapsed since the last tick and return the report to send now.
+const USB_JoystickReport_Input_t* Sequencer_Tick(Sequencer_t* const Sequencer, const uint16_t Elapsed);
+// The report as of the last tick.
+const USB_JoystickReport_Input_t* Sequencer_GetReport(const Sequencer_t* const Sequencer);
+// Number of host stalls the script was frozen through.
+uint16_t Sequencer_GetStallCount(const Sequencer_t* const Sequencer);
+// Times the script went back to its loop point since it started.
+uint16_t Sequencer_GetLoopCount(const Sequencer_t* const Sequencer);
+// Offset of the next command of a track from the start of its stream, 0xFFFF if the script doesn't use it.
+// Inside a subroutine, that's the command after the outermost CALL.
+uint16_t Sequencer_GetPosition(Sequencer_t* const Sequencer, const uint8_t Track);
+
+#endif
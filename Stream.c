@@ -0,0 +1,174 @@
+/*
+Reports streamed from a PC.
+
+Once stream.py sends STREAM_REQ_START, the script is put aside and the
+controller plays timed reports that the PC sends on the OUT endpoint. They
+queue up in a ring buffer in SRAM, so the automation can run for as long as
+the PC keeps sending, whatever its length.
+
+Flow control comes from credits. STREAM_REQ_STATUS tells the host how many
+entries the ring can still take, and stream.py never sends more than that. If
+a packet still doesn't fit, it is left in the endpoint bank. The hardware then
+NAKs the host until the ring has room, so no entry is ever dropped.
+
+The Switch never sends the vendor requests, so with it the controller only
+ever runs its script.
+*/
+
+#include "Stream.h"
+#include "Sequencer.h"
+
+// Request handed from the interrupt to the main loop, 0 when there is none.
+static volatile uint8_t pending = 0;
+static volatile bool active = false;
+
+// Entries are written at head by Stream_ReadEntries() and played from tail by Stream_Tick(), both in the main loop.
+static StreamEntry_t ring[STREAM_RING_SIZE];
+static volatile uint8_t head = 0;
+static volatile uint8_t tail = 0;
+
+static USB_JoystickReport_Input_t report;
+static bool playing = false;         // report holds an entry, rather than the neutral report of an empty ring
+static int16_t remaining = 0;        // Milliseconds left of the entry being played
+// Read by the interrupt for STREAM_REQ_STATUS, which may catch them halfway through an increment.
+static uint16_t played = 0;
+static uint16_t underruns = 0;
+
+static void Neutral(void) {
+	report.Button = 0;
+	report.HAT = HAT_CENTER;
+	report.LX = STICK_CENTER;
+	report.LY = STICK_CENTER;
+	report.RX = STICK_CENTER;
+	report.RY = STICK_CENTER;
+	report.VendorSpec = 0;
+}
+
+static uint8_t Credits(void) {
+	return STREAM_RING_SIZE - (uint8_t)(head - tail);
+}
+
+// Take the vendor requests of stream.py, from the control request event.
+void Stream_ControlRequest(void) {
+	const uint8_t type = USB_ControlRequest.bmRequestType;
+	const uint8_t request = USB_ControlRequest.bRequest;
+
+	if ((type & (CONTROL_REQTYPE_TYPE | CONTROL_REQTYPE_RECIPIENT)) != (REQTYPE_VENDOR | REQREC_DEVICE))
+		return;
+
+	if (request == STREAM_REQ_STATUS && (type & REQDIR_DEVICETOHOST))
+	{
+		// A request still waiting for the main loop already changes what the host may send.
+		const bool starting = (pending == STREAM_REQ_START);
+		const StreamStatus_t status = {
+			.Active    = (pending ? starting : active),
+			.Credits   = (starting ? STREAM_RING_SIZE : Credits()),
+			.Played    = (starting ? 0 : played),
+			.Underruns = (starting ? 0 : underruns)
+		};
+
+		Endpoint_ClearSETUP();
+		Endpoint_Write_Control_Stream_LE(&status, sizeof(status));
+		Endpoint_ClearOUT();
+		return;
+	}
+
+	// Left unhandled, the request is stalled and the host tries again later.
+	if ((request != STREAM_REQ_START && request != STREAM_REQ_STOP) || (type & REQDIR_DEVICETOHOST) || pending)
+		return;
+
+	Endpoint_ClearSETUP();
+	Endpoint_ClearStatusStage();
+	pending = request;
+}
+
+// Carry out the last request from the main loop. Returns true when streaming just stopped.
+bool Stream_Task(void) {
+	const uint8_t request = pending;
+	const bool was_active = active;
+
+	if (request == STREAM_REQ_START)
+	{
+		head = tail = 0;
+		playing = false;
+		remaining = 0;
+		played = underruns = 0;
+		Neutral();
+		active = true;
+	}
+	else if (request == STREAM_REQ_STOP)
+	{
+		active = false;
+	}
+
+	pending = 0;
+	return (was_active && !active);
+}
+
+// Whether reports come from the stream rather than the script.
+bool Stream_IsActive(void) {
+	return active;
+}
+
+// Take the entries waiting on the selected OUT endpoint, if they fit the ring. Never waits.
+void Stream_ReadEntries(void) {
+	if (!Endpoint_IsOUTReceived())
+		return;
+
+	// Bytes past the last whole entry are dropped with the packet.
+	const uint8_t count = Endpoint_BytesInEndpoint() / sizeof(StreamEntry_t);
+
+	// Left in the bank, the packet is NAKed back to the host until the ring has room for it.
+	if (count > Credits())
+		return;
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		uint8_t* const entry = (uint8_t*)&ring[head % STREAM_RING_SIZE];
+
+		for (uint8_t j = 0; j < sizeof(StreamEntry_t); j++)
+			entry[j] = Endpoint_Read_8();
+		head++;
+	}
+
+	Endpoint_ClearOUT();
+}
+
+// The report to send, Elapsed milliseconds after the last call.
+const USB_JoystickReport_Input_t* Stream_Tick(const uint16_t Elapsed) {
+	// Like the script, the stream is frozen while the host isn't listening.
+	if (Elapsed > SEQUENCER_STALL_MS)
+		return &report;
+
+	if (playing)
+		remaining -= Elapsed;
+
+	// As in the sequencer, we move on by at most one entry per tick and carry any overshoot into the next one.
+	if (!playing || remaining <= 0)
+	{
+		if (head != tail)
+		{
+			const StreamEntry_t* const entry = &ring[tail % STREAM_RING_SIZE];
+
+			report.Button = entry->Report.Button;
+			report.HAT = entry->Report.HAT;
+			report.LX = entry->Report.LX;
+			report.LY = entry->Report.LY;
+			report.RX = entry->Report.RX;
+			report.RY = entry->Report.RY;
+			remaining = (playing ? remaining : 0) + entry->Duration;
+			playing = true;
+			tail++;
+			played++;
+		}
+		else if (playing)
+		{
+			// The host fell behind. Let go of everything rather than hold a press for longer than asked.
+			Neutral();
+			playing = false;
+			underruns++;
+		}
+	}
+
+	return &report;
+}
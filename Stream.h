@@ -0,0 +1,52 @@
+/** \file
+ *
+ *  Header file for Stream.c.
+ */
+
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Joystick.h"
+
+// Macros
+// Entries the ring buffer holds. A power of two, so the indexes wrap for free.
+#define STREAM_RING_SIZE      32
+
+// Type Defines
+// Vendor requests to the device, sent by stream.py. They follow the requests of Upload.h.
+enum {
+	STREAM_REQ_START = 0x06, // OUT: empty the ring and play what arrives on the OUT endpoint instead of the script
+	STREAM_REQ_STOP,         // OUT: go back to the script, from its start
+	STREAM_REQ_STATUS        // IN, StreamStatus_t
+};
+
+// One timed report, as sent on the OUT endpoint. A packet carries as many whole entries as fit in it.
+typedef struct {
+	USB_JoystickReport_Output_t Report;
+	uint16_t Duration;   // Milliseconds to hold the report for, up to 32767
+} ATTR_PACKED StreamEntry_t;
+
+typedef struct {
+	uint8_t  Active;     // The stream plays instead of the script
+	uint8_t  Credits;    // Entries the host may send before asking again
+	uint16_t Played;     // Entries played since STREAM_REQ_START
+	uint16_t Underruns;  // Times the ring ran dry while streaming
+} ATTR_PACKED StreamStatus_t;
+
+// Function Prototypes
+// Take the vendor requests of stream.py, from the control request event.
+void Stream_ControlRequest(void);
+// Carry out the last request from the main loop. Returns true when streaming just stopped.
+bool Stream_Task(void);
+// Whether reports come from the stream rather than the script.
+bool Stream_IsActive(void);
+// Take the entries waiting on the selected OUT endpoint, if they fit the ring. Never waits.
+void Stream_ReadEntries(void);
+// The report to send, Elapsed milliseconds after the last call.
+const USB_JoystickReport_Input_t* Stream_Tick(const uint16_t Elapsed);
+
+#endif
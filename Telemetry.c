@@ -0,0 +1,126 @@
+/*
+Telemetry side channel, built with `make telemetry`.
+
+A second, vendor-defined HID interface next to the joystick one, so a PC can
+see what the controller is doing while it plays rather than guess from the
+screen: the counters of the other modules, where each track of the script is,
+and a trace of the reports it sent. The host sends a command report and reads
+one answer (see telemetry.py). The joystick interface and its endpoints are
+never touched, and the interface is left out of the default build so the
+controller still looks like the plain HORI pad to the Switch.
+
+Everything runs from the main loop, one step per pass: a command is read only
+once the answer to the previous one is out.
+*/
+
+#include "Telemetry.h"
+
+#ifdef TELEMETRY_INTERFACE
+
+#include "HID.h"
+#include "Stream.h"
+#include "Upload.h"
+
+static TelemetryTraceEntry_t trace[TELEMETRY_TRACE_SIZE];
+static uint8_t trace_head = 0;
+static uint8_t trace_tail = 0;
+static uint16_t trace_lost = 0;
+static USB_JoystickReport_Input_t last_traced;
+
+static uint8_t answer[TELEMETRY_EPSIZE];
+static bool answering = false;
+
+static void Status(const uint16_t Now, Sequencer_t* const Sequencer) {
+	TelemetryStatus_t* const status = (TelemetryStatus_t*)answer;
+
+	status->Time = Now;
+	status->Setting = Upload_GetSetting();
+	status->Streaming = Stream_IsActive();
+	status->Loops = Sequencer_GetLoopCount(Sequencer);
+	for (uint8_t i = 0; i < SCRIPT_TRACKS; i++)
+		status->Position[i] = Sequencer_GetPosition(Sequencer, i);
+	status->Stalls = Sequencer_GetStallCount(Sequencer);
+	status->MissedPolls = HID_GetMissedPollCount();
+	status->Deferred = HID_GetDeferCount();
+	status->TraceLost = trace_lost;
+}
+
+static void Trace(void) {
+	TelemetryTrace_t* const batch = (TelemetryTrace_t*)answer;
+
+	while (batch->Count < TELEMETRY_TRACE_BATCH && trace_tail != trace_head)
+		batch->Entries[batch->Count++] = trace[trace_tail++ % TELEMETRY_TRACE_SIZE];
+}
+
+// Answer the command waiting on the telemetry interface about the controller running Sequencer, if any.
+// Returns true when the script should start over.
+bool Telemetry_Task(const uint16_t Now, Sequencer_t* const Sequencer) {
+	bool restart = false;
+
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+		return false;
+
+	if (!answering)
+	{
+		// A short or empty packet leaves the rest of it zero, which is no command.
+		uint8_t command[TELEMETRY_EPSIZE] = { 0 };
+
+		Endpoint_SelectEndpoint(TELEMETRY_OUT_EPADDR);
+		if (!Endpoint_IsOUTReceived())
+			return false;
+		HID_ReadReport(command, sizeof(command));
+
+		memset(answer, 0, sizeof(answer));
+		answer[0] = command[0];
+		switch (command[0])
+		{
+			case TELEMETRY_CMD_STATUS:
+				Status(Now, Sequencer);
+				break;
+			case TELEMETRY_CMD_TRACE:
+				Trace();
+				break;
+			case TELEMETRY_CMD_RESTART:
+				restart = true;
+				break;
+		}
+		answering = true;
+	}
+
+	// Not HID_CanWriteReport(): the host polls this endpoint all the time for nothing, and those aren't missed polls.
+	Endpoint_SelectEndpoint(TELEMETRY_IN_EPADDR);
+	if (Endpoint_IsINReady() && Endpoint_IsReadWriteAllowed())
+	{
+		HID_WriteReport(answer, sizeof(answer));
+		answering = false;
+	}
+
+	return restart;
+}
+
+// Record the report about to be sent, if it differs from the last one recorded.
+void Telemetry_Trace(const USB_JoystickReport_Input_t* const Report, const uint16_t Now) {
+	TelemetryTraceEntry_t* entry;
+
+	if (memcmp(Report, &last_traced, sizeof(last_traced)) == 0)
+		return;
+	last_traced = *Report;
+
+	// A full buffer drops its oldest entry, the recent past being what the host wants to see.
+	if ((uint8_t)(trace_head - trace_tail) == TELEMETRY_TRACE_SIZE)
+	{
+		trace_tail++;
+		trace_lost++;
+	}
+
+	entry = &trace[trace_head++ % TELEMETRY_TRACE_SIZE];
+	entry->Time = Now;
+	entry->Button = Report->Button;
+	entry->HAT = Report->HAT;
+	entry->LX = Report->LX;
+	entry->LY = Report->LY;
+	entry->RX = Report->RX;
+	entry->RY = Report->RY;
+}
+
+#endif
@@ -0,0 +1,69 @@
+/** \file
+ *
+ *  Header file for Telemetry.c.
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "Joystick.h"
+#include "Script.h"
+#include "Sequencer.h"
+
+// Macros
+// Report changes the trace buffer holds. A power of two, so the indexes wrap for free.
+#define TELEMETRY_TRACE_SIZE  16
+// Trace entries sent per TELEMETRY_CMD_TRACE answer, as many as fit in a report.
+#define TELEMETRY_TRACE_BATCH 3
+
+// Type Defines
+// Commands the host sends in the first byte of a report on the telemetry interface. Each is answered
+// by one report, starting with the command.
+enum {
+	TELEMETRY_CMD_STATUS = 0x01, // TelemetryStatus_t
+	TELEMETRY_CMD_TRACE,         // TelemetryTrace_t, taking the oldest entries out of the trace buffer
+	TELEMETRY_CMD_RESTART        // Start the script over; answered by the command alone
+};
+
+// One change of the report sent to the joystick interface.
+typedef struct {
+	uint16_t Time;       // Millisecond clock of the change
+	uint16_t Button;
+	uint8_t  HAT;
+	uint8_t  LX;
+	uint8_t  LY;
+	uint8_t  RX;
+	uint8_t  RY;
+} ATTR_PACKED TelemetryTraceEntry_t;
+
+typedef struct {
+	uint8_t  Command;
+	uint16_t Time;                    // Millisecond clock
+	uint8_t  Setting;                 // Script setting, see Upload_GetSetting()
+	uint8_t  Streaming;               // Reports come from stream.py rather than the script
+	uint16_t Loops;                   // Times the script went back to its loop point
+	uint16_t Position[SCRIPT_TRACKS]; // See Sequencer_GetPosition()
+	uint16_t Stalls;                  // See Sequencer_GetStallCount()
+	uint16_t MissedPolls;             // See HID_GetMissedPollCount()
+	uint16_t Deferred;                // See HID_GetDeferCount()
+	uint16_t TraceLost;               // Trace entries overwritten before the host read them
+} ATTR_PACKED TelemetryStatus_t;
+
+typedef struct {
+	uint8_t  Command;
+	uint8_t  Count;                   // Entries that follow, 0 once the trace buffer is empty
+	TelemetryTraceEntry_t Entries[TELEMETRY_TRACE_BATCH];
+} ATTR_PACKED TelemetryTrace_t;
+
+// Function Prototypes
+// Answer the command waiting on the telemetry interface about the controller running Sequencer, if any.
+// Returns true when the script should start over.
+bool Telemetry_Task(const uint16_t Now, Sequencer_t* const Sequencer);
+// Record the report about to be sent, if it differs from the last one recorded.
+void Telemetry_Trace(const USB_JoystickReport_Input_t* const Report, const uint16_t Now);
+
+#endif
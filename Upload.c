@@ -0,0 +1,194 @@
+/*
+Script upload over USB.
+
+A PC sends a script image compiled by script2c.py with vendor control requests
+(see upload.py). The image goes into whichever of the two EEPROM slots is not
+in use, and only once its CRC checks out does that slot become the active one,
+with a single byte write. An upload cut short leaves the previous script
+running, and the sequencer runs the uploaded image in place from EEPROM.
+
+The control requests arrive in the USB interrupt, where they are only copied
+into SRAM. Upload_Task() does the EEPROM work from the main loop, one byte
+write per pass, so the sequencer's EEPROM reads never race with a write and
+the main loop never waits on more than one write at a time.
+
+Writing a reserved flash page instead would need SPM, which only runs from the
+bootloader section, and the Teensy bootloader doesn't offer it to us.
+*/
+
+#include "Upload.h"
+
+typedef struct {
+	uint16_t Length; // Bytes of image
+	uint16_t CRC;    // _crc16_update over the image, starting from 0xFFFF
+	uint8_t  Image[UPLOAD_SLOT_SIZE];
+} UploadSlot_t;
+
+static UploadSlot_t EEMEM slots[2];
+static uint8_t EEMEM stored_slot;    // Slot of the last committed upload
+static uint8_t EEMEM stored_setting; // Script to run, see Upload_GetSetting()
+
+// The EEPROM settings, mirrored so the interrupt can report them.
+static uint8_t active_slot;
+static uint8_t setting;
+
+// Request handed from the interrupt to the main loop, 0 when there is none.
+static volatile uint8_t pending = 0;
+static uint16_t pending_value;
+static uint16_t pending_offset;
+static uint8_t  pending_length;
+static uint8_t  buffer[UPLOAD_CHUNK_SIZE];
+static uint8_t  written;             // Bytes of the buffer already in EEPROM
+static volatile uint8_t result = UPLOAD_OK;
+
+// The upload in progress.
+static uint16_t length;              // Image length announced by UPLOAD_REQ_BEGIN
+static uint8_t  target;              // Slot it goes to
+
+static uint16_t SlotCRC(const UploadSlot_t* const slot, const uint16_t bytes) {
+	uint16_t crc = 0xFFFF;
+
+	for (uint16_t i = 0; i < bytes; i++)
+		crc = _crc16_update(crc, eeprom_read_byte(&slot->Image[i]));
+
+	return crc;
+}
+
+// Load the settings kept in EEPROM.
+void Upload_Init(void) {
+	active_slot = eeprom_read_byte(&stored_slot);
+	setting = eeprom_read_byte(&stored_setting);
+}
+
+// Take the vendor requests of upload.py, from the control request event.
+void Upload_ControlRequest(void) {
+	const uint8_t type = USB_ControlRequest.bmRequestType;
+	const uint8_t request = USB_ControlRequest.bRequest;
+
+	if ((type & (CONTROL_REQTYPE_TYPE | CONTROL_REQTYPE_RECIPIENT)) != (REQTYPE_VENDOR | REQREC_DEVICE))
+		return;
+
+	if (request == UPLOAD_REQ_STATUS && (type & REQDIR_DEVICETOHOST))
+	{
+		const UploadStatus_t status = {
+			.Busy       = (pending != 0),
+			.Result     = result,
+			.Setting    = setting,
+			.ActiveSlot = active_slot,
+			.SlotSize   = UPLOAD_SLOT_SIZE
+		};
+
+		Endpoint_ClearSETUP();
+		Endpoint_Write_Control_Stream_LE(&status, sizeof(status));
+		Endpoint_ClearOUT();
+		return;
+	}
+
+	// Left unhandled, the request is stalled and the host tries again later.
+	if (request < UPLOAD_REQ_BEGIN || request > UPLOAD_REQ_SELECT || (type & REQDIR_DEVICETOHOST) ||
+	    pending || USB_ControlRequest.wLength > sizeof(buffer))
+		return;
+
+	Endpoint_ClearSETUP();
+	if (USB_ControlRequest.wLength)
+		Endpoint_Read_Control_Stream_LE(buffer, USB_ControlRequest.wLength);
+	Endpoint_ClearStatusStage();
+
+	pending_value = USB_ControlRequest.wValue;
+	pending_offset = USB_ControlRequest.wIndex;
+	pending_length = USB_ControlRequest.wLength;
+	written = 0;
+	pending = request;
+}
+
+// Carry out the last request from the main loop. Returns true when the script setting changed.
+bool Upload_Task(void) {
+	bool changed = false;
+
+	switch (pending)
+	{
+		case 0:
+			return false;
+
+		case UPLOAD_REQ_BEGIN:
+			target = (active_slot == 0) ? 1 : 0;
+			length = (pending_value <= UPLOAD_SLOT_SIZE) ? pending_value : 0;
+			result = length ? UPLOAD_OK : UPLOAD_BAD_LENGTH;
+			break;
+
+		case UPLOAD_REQ_DATA:
+			if (pending_offset > length || pending_length > length - pending_offset)
+			{
+				result = UPLOAD_BAD_LENGTH;
+				break;
+			}
+
+			// One byte per pass, and only once the last write is done.
+			if (written < pending_length)
+			{
+				if (eeprom_is_ready())
+				{
+					eeprom_update_byte(&slots[target].Image[pending_offset + written], buffer[written]);
+					written++;
+				}
+				return false;
+			}
+
+			result = UPLOAD_OK;
+			break;
+
+		case UPLOAD_REQ_COMMIT:
+			if (length < sizeof(Script_t) || SlotCRC(&slots[target], length) != pending_value)
+			{
+				result = UPLOAD_BAD_CRC;
+				break;
+			}
+
+			// Seal the slot, then switch over with a single byte write. These few writes do hold up the main loop once.
+			eeprom_update_word(&slots[target].Length, length);
+			eeprom_update_word(&slots[target].CRC, pending_value);
+			eeprom_update_byte(&stored_slot, target);
+			active_slot = target;
+			length = 0;
+			Upload_SetSetting(SCRIPT_UPLOADED);
+			result = UPLOAD_OK;
+			changed = true;
+			break;
+
+		case UPLOAD_REQ_SELECT:
+			Upload_SetSetting(pending_value);
+			result = UPLOAD_OK;
+			changed = true;
+			break;
+	}
+
+	pending = 0;
+	return changed;
+}
+
+// The script setting: a bank index, SCRIPT_UPLOADED, or 0xFF on a blank chip.
+uint8_t Upload_GetSetting(void) {
+	return setting;
+}
+
+void Upload_SetSetting(const uint8_t Setting) {
+	setting = Setting;
+	eeprom_update_byte(&stored_setting, Setting);
+}
+
+// The uploaded script, in EEPROM, or NULL if there is no intact one.
+const Script_t* Upload_GetScript(void) {
+	const UploadSlot_t* slot;
+	uint16_t bytes;
+
+	// Anything but 0 or 1 means nothing was committed yet, or the switch-over byte was cut short.
+	if (active_slot > 1)
+		return NULL;
+
+	slot = &slots[active_slot];
+	bytes = eeprom_read_word(&slot->Length);
+	if (bytes < sizeof(Script_t) || bytes > UPLOAD_SLOT_SIZE || SlotCRC(slot, bytes) != eeprom_read_word(&slot->CRC))
+		return NULL;
+
+	return (const Script_t*)slot->Image;
+}
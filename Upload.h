@@ -0,0 +1,64 @@
+/** \file
+ *
+ *  Header file for Upload.c.
+ */
+
+#ifndef _UPLOAD_H_
+#define _UPLOAD_H_
+
+/* Includes: */
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+#include "Joystick.h"
+#include "Script.h"
+
+// Macros
+// Bytes of script image each of the two EEPROM slots can hold.
+#define UPLOAD_SLOT_SIZE      500
+// Largest data stage of an UPLOAD_REQ_DATA request.
+#define UPLOAD_CHUNK_SIZE     FIXED_CONTROL_ENDPOINT_SIZE
+// Script setting that runs the uploaded script rather than an entry of the firmware's bank.
+#define SCRIPT_UPLOADED       0xFE
+
+// Type Defines
+// Vendor requests to the device, sent by upload.py. OUT requests are stalled while the previous one is still being carried out.
+enum {
+	UPLOAD_REQ_BEGIN = 0x01, // OUT, wValue = image length: start writing an image into the inactive slot
+	UPLOAD_REQ_DATA,         // OUT, wIndex = offset in the image, data = up to UPLOAD_CHUNK_SIZE image bytes
+	UPLOAD_REQ_COMMIT,       // OUT, wValue = CRC-16 of the image: check it, make the slot active and run it
+	UPLOAD_REQ_SELECT,       // OUT, wValue = script setting: a bank index or SCRIPT_UPLOADED
+	UPLOAD_REQ_STATUS        // IN, UploadStatus_t
+};
+
+// Outcome of the last OUT request.
+enum {
+	UPLOAD_OK,
+	UPLOAD_BAD_LENGTH,       // The image or chunk doesn't fit the slot
+	UPLOAD_BAD_CRC           // The slot doesn't hold what the host sent
+};
+
+typedef struct {
+	uint8_t  Busy;       // An OUT request is still being carried out
+	uint8_t  Result;     // UPLOAD_OK or the error of the last OUT request
+	uint8_t  Setting;    // Script setting in use
+	uint8_t  ActiveSlot; // Slot of the uploaded script, 0xFF if none was ever committed
+	uint16_t SlotSize;
+} ATTR_PACKED UploadStatus_t;
+
+// Function Prototypes
+// Load the settings kept in EEPROM.
+void Upload_Init(void);
+// Take the vendor requests of upload.py, from the control request event.
+void Upload_ControlRequest(void);
+// Carry out the last request from the main loop. Returns true when the script setting changed.
+bool Upload_Task(void);
+// The script setting: a bank index, SCRIPT_UPLOADED, or 0xFF on a blank chip.
+uint8_t Upload_GetSetting(void);
+void Upload_SetSetting(const uint8_t Setting);
+// The uploaded script, in EEPROM, or NULL if there is no intact one.
+const Script_t* Upload_GetScript(void);
+
+#endif
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <avr/io.h>
 #include <util/delay.h>
 #include "print.h"
@@ -28,18 +29,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timer.h"
 #include "matrix.h"
 #include "config.h"
+#include "Columns.h"
+#include "Debounce.h"
 
 
-#ifndef DEBOUNCE
-#   define DEBOUNCE	5
-#endif
-static bool debouncing = false;
-static uint16_t debouncing_time = 0;
+/* debouncing of each row: the matrix is scanned once per millisecond, each
+ * scan a sample of its counters (see Debounce.c) */
+#define SCAN_SAMPLES DEBOUNCE_SAMPLES(1000)
+static DebounceRow_t debounce[MATRIX_ROWS];
+static uint16_t scan_time = 0;
 
 
 /* matrix state(1:on, 0:off) */
 static matrix_row_t matrix[MATRIX_ROWS];
-static matrix_row_t matrix_debouncing[MATRIX_ROWS];
 
 static matrix_row_t read_cols(void);
 static void init_cols(void);
@@ -56,32 +58,24 @@ void matrix_init(void)
     // initialize matrix state: all keys off
     for (uint8_t i=0; i < MATRIX_ROWS; i++) {
         matrix[i] = 0;
-        matrix_debouncing[i] = 0;
     }
+    memset(debounce, 0, sizeof(debounce));
 }
 
 uint8_t matrix_scan(void)
 {
+    if (timer_read() == scan_time) {
+        return 0;
+    }
+    scan_time = timer_read();
+
     for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
         select_row(i);
         _delay_us(1);  // delay for settling
         matrix_row_t cols = read_cols();
-        if (matrix_debouncing[i] != cols) {
-            if (debouncing) {
-                dprintf("bounce: %d %d@%02X\n", timer_elapsed(debouncing_time), i, matrix_debouncing[i]^cols);
-            }
-            matrix_debouncing[i] = cols;
-            debouncing = true;
-            debouncing_time = timer_read();
-        }
         unselect_rows();
-    }
-
-    if (debouncing && timer_elapsed(debouncing_time) >= DEBOUNCE) {
-        for (uint8_t i = 0; i < MATRIX_ROWS; i++) {
-            matrix[i] = matrix_debouncing[i];
-        }
-        debouncing = false;
+        // presses are debounced too: these keys pick a script at boot, there is no hurry
+        matrix[i] = Debounce_Row(&debounce[i], cols, 0, SCAN_SAMPLES);
     }
 
     return 1;
@@ -113,18 +107,24 @@ static void  init_cols(void)
     PORTB |=  (1<<4 | 1<<5);
 }
 
+/* Columns of the pins of each port nibble, lowest pin first (see Columns.h)
+ * col: 0   1   2   3   4   5   6   7   8   9
+ * pin: D3  D2  D1  D0  D4  C6  D7  E6  B4  B5
+ */
+static const matrix_row_t cols_d_low[16] PROGMEM = COLUMN_TABLE(1<<3, 1<<2, 1<<1, 1<<0);
+static const matrix_row_t cols_d_high[16] PROGMEM = COLUMN_TABLE(1<<4, 0, 0, 1<<6);
+static const matrix_row_t cols_c_high[16] PROGMEM = COLUMN_TABLE(0, 0, 1<<5, 0);
+static const matrix_row_t cols_e_high[16] PROGMEM = COLUMN_TABLE(0, 0, 1<<7, 0);
+static const matrix_row_t cols_b_high[16] PROGMEM = COLUMN_TABLE(1<<8, 1<<9, 0, 0);
+
 static matrix_row_t read_cols(void)
 {
-    return (PIND&(1<<3) ? 0 : (1<<0)) |
-           (PIND&(1<<2) ? 0 : (1<<1)) |
-           (PIND&(1<<1) ? 0 : (1<<2)) |
-           (PIND&(1<<0) ? 0 : (1<<3)) |
-           (PIND&(1<<4) ? 0 : (1<<4)) |
-           (PINC&(1<<6) ? 0 : (1<<5)) |
-           (PIND&(1<<7) ? 0 : (1<<6)) |
-           (PINE&(1<<6) ? 0 : (1<<7)) |
-           (PINB&(1<<4) ? 0 : (1<<8)) |
-           (PINB&(1<<5) ? 0 : (1<<9));
+    // One read of each port, back to back, so that all columns are sampled together.
+    const uint8_t d = PIND, c = PINC, e = PINE, b = PINB;
+
+    return COLUMNS_LOW(cols_d_low, d) | COLUMNS_HIGH(cols_d_high, d) |
+           COLUMNS_HIGH(cols_c_high, c) | COLUMNS_HIGH(cols_e_high, e) |
+           COLUMNS_HIGH(cols_b_high, b);
 }
 
 /* Row pin configuration
@@ -0,0 +1,69 @@
+#!/bin/python
+
+# Measures how often a Linux host actually polls the controller, from the
+# reports the firmware sends back. Both firmwares answer every poll with a
+# report, so the report rate on the hidraw device is the poll rate.
+#
+#   pollrate.py /dev/hidraw3
+#
+# Find the device with `dmesg | grep hidraw` after plugging in, and run as root
+# or with a udev rule for it. Compare a normal build with `make fast-poll`.
+
+from __future__ import print_function
+
+import sys, os, time, getopt
+
+def measure(path, duration):
+  fd = os.open(path, os.O_RDONLY)
+  stamps = []
+  try:
+    # Wait for the first report, so the time to open the device isn't counted.
+    os.read(fd, 64)
+    start = time.time()
+    while time.time() - start < duration:
+      os.read(fd, 64)
+      stamps.append(time.time())
+  finally:
+    os.close(fd)
+  return start, stamps
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "ht:")
+  duration = 5.0
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-t':
+      duration = float(arg)
+
+  start, stamps = measure(args[0], duration)
+  if len(stamps) < 2:
+    print("ERROR: {} sent no reports".format(args[0]))
+    sys.exit(1)
+
+  elapsed = stamps[-1] - start
+  print("{} reports in {:.3f} s: {:.1f} reports/s, one every {:.2f} ms".format(
+    len(stamps), elapsed, len(stamps) / elapsed, 1000.0 * elapsed / len(stamps)))
+
+  # Single intervals are only as good as the scheduler's wake-ups, the average above is what counts.
+  intervals = {}
+  previous = start
+  for stamp in stamps:
+    ms = int(round((stamp - previous) * 1000))
+    intervals[ms] = intervals.get(ms, 0) + 1
+    previous = stamp
+  for ms in sorted(intervals):
+    print("  {:>3} ms: {}".format(ms, intervals[ms]))
+
+def usage():
+  print("To measure the report rate for 5 seconds: pollrate.py /dev/hidrawN")
+  print("To measure for another duration: pollrate.py -t seconds /dev/hidrawN")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,177 @@
+#!/bin/python
+
+# Plays the Switch's part of the Pro Controller protocol against a firmware
+# built with `make pro` (see ProController.c), checking every answer it gets,
+# then shows the input reports that follow. Needs pyusb, and on Linux access to
+# the device (root or a udev rule). The HID driver is detached from the
+# controller first, so that nothing else talks to it meanwhile.
+#
+# The script isn't started until the handshake is done, so what it shows is the
+# start of the script.
+
+from __future__ import print_function
+
+import sys, getopt
+import usb.core
+
+VENDOR_ID = 0x057E
+PRODUCT_ID = 0x2009
+
+IN_ENDPOINT = 0x81                        # JOYSTICK_IN_EPADDR
+OUT_ENDPOINT = 0x02                       # JOYSTICK_OUT_EPADDR
+REPORT_SIZE = 64                          # PRO_REPORT_SIZE
+
+OUT_SUBCOMMAND, OUT_USB = 0x01, 0x80
+IN_REPLY, IN_FULL, IN_USB = 0x21, 0x30, 0x81
+PRO_CONTROLLER = 0x03                     # Controller type
+NEUTRAL_RUMBLE = [0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40]
+
+# What the firmware's flash image holds: a stick calibrated around 0x800, and no user calibration.
+STICK_CENTER = 0x800
+
+# The USB commands of the handshake, in order; the last one starts the input reports and has no answer.
+USB_COMMANDS = [0x01, 0x02, 0x03, 0x02, 0x04]
+
+def spi_read(address, length):
+  return [address & 0xFF, (address >> 8) & 0xFF, 0, 0, length]
+
+# The subcommands a Switch sends while connecting a Pro Controller, with their arguments.
+SUBCOMMANDS = [
+  (0x02, [], 'device info'),
+  (0x08, [0x00], 'shipment mode off'),
+  (0x10, spi_read(0x6000, 0x10), 'serial number'),
+  (0x10, spi_read(0x6050, 0x0D), 'colors'),
+  (0x03, [0x30], 'full input reports'),
+  (0x04, [], 'trigger times'),
+  (0x10, spi_read(0x6080, 0x18), 'IMU offsets, left stick parameters'),
+  (0x10, spi_read(0x6098, 0x12), 'right stick parameters'),
+  (0x10, spi_read(0x603D, 0x19), 'factory stick calibration'),
+  (0x10, spi_read(0x6020, 0x18), 'factory IMU calibration'),
+  (0x10, spi_read(0x8010, 0x18), 'user stick calibration'),
+  (0x10, spi_read(0x8028, 0x18), 'user IMU calibration'),
+  (0x21, [0x21, 0x00, 0x00], 'MCU config'),
+  (0x40, [0x01], 'IMU on'),
+  (0x48, [0x01], 'vibration on'),
+  (0x30, [0x01], 'player lights'),
+  (0x38, [0x01, 0x00, 0x00], 'HOME light'),
+]
+
+RIGHT = ['Y', 'X', 'B', 'A', 'SR', 'SL', 'R', 'ZR']
+SHARED = ['MINUS', 'PLUS', 'RCLICK', 'LCLICK', 'HOME', 'CAPTURE', '', 'GRIP']
+LEFT = ['DOWN', 'UP', 'RIGHT', 'LEFT', 'SR', 'SL', 'L', 'ZL']
+
+class ProtocolError(Exception):
+  pass
+
+def send(dev, report):
+  dev.write(OUT_ENDPOINT, bytes(bytearray(report + [0] * (REPORT_SIZE - len(report)))))
+
+def receive(dev, report_id):
+  # Input reports keep coming between answers once they started; skip them.
+  for _ in range(100):
+    report = bytearray(dev.read(IN_ENDPOINT, REPORT_SIZE, 1000))
+    if report[0] == report_id:
+      return report
+  raise ProtocolError('no report 0x{:02x} came'.format(report_id))
+
+def expect(condition, what):
+  if not condition:
+    raise ProtocolError(what)
+
+def stick(data):
+  return data[0] | (data[1] & 0x0F) << 8, data[1] >> 4 | data[2] << 4
+
+def check_spi(address, data):
+  if address == 0x603D:
+    # The left stick's maximum and minimum around its center, then the right stick's center.
+    expect(stick(data[3:6]) == (STICK_CENTER, STICK_CENTER), 'left stick not calibrated around its center')
+    expect(stick(data[9:12]) == (STICK_CENTER, STICK_CENTER), 'right stick not calibrated around its center')
+  elif address in (0x8010, 0x8028):
+    expect(all(b == 0xFF for b in data), 'there should be no user calibration')
+
+def handshake(dev, verbose):
+  mac = None
+  for command in USB_COMMANDS:
+    send(dev, [OUT_USB, command])
+    if command == 0x04:
+      break
+    answer = receive(dev, IN_USB)
+    expect(answer[1] == command, 'USB command 0x{:02x} answered as 0x{:02x}'.format(command, answer[1]))
+    if command == 0x01:
+      expect(answer[3] == PRO_CONTROLLER, 'not a Pro Controller: type 0x{:02x}'.format(answer[3]))
+      mac = answer[4:10][::-1]
+    if verbose:
+      print('USB 0x{:02x}: ok'.format(command))
+
+  timer = None
+  for n, (command, arguments, what) in enumerate(SUBCOMMANDS):
+    send(dev, [OUT_SUBCOMMAND, n & 0x0F] + NEUTRAL_RUMBLE + [command] + arguments)
+    answer = receive(dev, IN_REPLY)
+    ack, data = answer[13], answer[15:]
+    expect(answer[14] == command, 'subcommand 0x{:02x} answered as 0x{:02x}'.format(command, answer[14]))
+    expect(ack & 0x80, 'subcommand 0x{:02x} not acknowledged'.format(command))
+    expect(timer is None or answer[1] != timer, 'the timer of the answers stands still')
+    timer = answer[1]
+
+    if command == 0x02:
+      expect(data[2] == PRO_CONTROLLER, 'device info of type 0x{:02x}'.format(data[2]))
+      expect(data[4:10] == mac, 'device info and USB status give different MACs')
+    elif command == 0x10:
+      address = data[0] | data[1] << 8 | data[2] << 16 | data[3] << 24
+      expect(address == arguments[0] | arguments[1] << 8 and data[4] == arguments[4],
+             'SPI read of {} bytes at 0x{:04x} answered for {} at 0x{:04x}'.format(arguments[4], arguments[0] | arguments[1] << 8, data[4], address))
+      check_spi(address, data[5:5 + data[4]])
+    if verbose:
+      print('0x{:02x} {}: ack 0x{:02x}'.format(command, what, ack))
+
+  return ':'.join('{:02X}'.format(b) for b in mac)
+
+def show(report):
+  names = [n for byte, table in zip(report[3:6], [RIGHT, SHARED, LEFT]) for i, n in enumerate(table) if byte & (1 << i) and n]
+  left, right = stick(report[6:9]), stick(report[9:12])
+  print('{:>3}  left {:>4} {:>4}  right {:>4} {:>4}  {}'.format(report[1], left[0], left[1], right[0], right[1], ' '.join(names)))
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hn:v")
+  count = 20
+  verbose = False
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-n':
+      count = int(arg)
+    elif opt == '-v':
+      verbose = True
+
+  dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+  if dev is None:
+    print("ERROR: No controller found!")
+    sys.exit(1)
+  if dev.is_kernel_driver_active(0):
+    dev.detach_kernel_driver(0)
+
+  try:
+    mac = handshake(dev, verbose)
+    print("Handshake done, the controller answers as a Pro Controller with MAC {}".format(mac))
+    last = None
+    shown = 0
+    while shown < count:
+      report = receive(dev, IN_FULL)
+      # Only changes, as the same report comes at every poll.
+      if report[3:12] != last:
+        show(report)
+        last = report[3:12]
+        shown += 1
+  except ProtocolError as e:
+    print("ERROR: {}".format(e))
+    sys.exit(1)
+
+def usage():
+  print("To connect to the controller as a Switch would and show its first 20 input changes: procon.py")
+  print("To show another number of them: procon.py -n count")
+  print("To show every step of the handshake: procon.py -v")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,75 @@
+#!/bin/python
+
+# Shows how evenly the fightstick firmware (Keyb-pcb.c) scans its key matrix
+# from the timer interrupt (see ScanTimer.c): the rate, how long each scan
+# waited to start after the timer fired, and how long the longest one took.
+# Needs pyusb, and on Linux access to the device (root or a udev rule).
+#
+# The counts start over at every reading, so each line covers the time since
+# the one before. Waits come from the USB interrupt, so they are longest while
+# the host is enumerating the controller or sending it control requests. The
+# scan count wraps at 65535, half a minute at 2 kHz, so keep -w below that.
+
+from __future__ import print_function
+
+import sys, struct, time, getopt
+import usb.core
+
+VENDOR_ID = 0x0F0D
+PRODUCT_ID = 0x0092
+
+REQ_STATUS = 0x09
+IN = 0xC0                                 # vendor request, device to host
+STATUS = struct.Struct('<HHHHHHH')        # ScanStatus_t
+NO_SCAN = 0xFFFF                          # MinLatency before any scan was timed
+
+def read_status(dev):
+  return STATUS.unpack(bytes(bytearray(dev.ctrl_transfer(IN, REQ_STATUS, 0, 0, STATUS.size))))
+
+def print_status(status):
+  rate, period, scans, late, min_latency, max_latency, max_duration = status
+  # The timer counts period times per scan.
+  us = 1e6 / (rate * period)
+  if min_latency == NO_SCAN:
+    print('{} Hz  no scans timed'.format(rate))
+    return
+  print('{} Hz  {:>6} scans  wait {:6.2f} to {:6.2f} us  jitter {:6.2f} us  longest scan {:6.2f} us  late {}'.format(
+    rate, scans, min_latency * us, max_latency * us, (max_latency - min_latency) * us, max_duration * us, late))
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hn:w:")
+  count = 1
+  interval = 1.0
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-n':
+      count = int(arg)
+    elif opt == '-w':
+      interval = float(arg)
+
+  dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+  if dev is None:
+    print("ERROR: No controller found!")
+    sys.exit(1)
+
+  try:
+    # Start the counts over, so that the first line only covers the wait below.
+    read_status(dev)
+  except usb.core.USBError:
+    print("ERROR: This firmware doesn't time its scans, it should be the fightstick one (Keyb-pcb.c)")
+    sys.exit(1)
+
+  for _ in range(count):
+    time.sleep(interval)
+    print_status(read_status(dev))
+
+def usage():
+  print("To show the scan timing over one second: scanjitter.py")
+  print("To show n lines of it: scanjitter.py -n n")
+  print("To have each line cover s seconds: scanjitter.py -w s")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,460 @@
+#!/bin/python
+
+# Compiles a text script into the packed command streams of Script.h.
+#
+#   script2c.py bowling.script
+#
+# writes bowling_script.c (the streams and a Script_t, all in PROGMEM) and
+# bowling_script.h (declaring bowling_script), then prints how long the script
+# runs and what it costs. With -b it also writes bowling_script.bin, the image
+# upload.py sends to the EEPROM of a running firmware.
+#
+# One statement per line, '#' starts a comment, durations are in milliseconds:
+#
+#   track buttons             switch to a track (buttons, left_stick, right_stick, hat)
+#   A 144                     press a Buttons_t input (see Script.h) for 144 ms
+#   wait 504                  press nothing for 504 ms
+#   lstick 255 128 500        hold the left stick at (255, 128) for 500 ms (rstick for the right one)
+#   lramp 128 128 255 0 800   sweep the left stick from (128, 128) to (255, 0) in 800 ms (rramp)
+#   repeat 3 ... end          run the block three times
+#   sub name ... end          define a subroutine, at top level only
+#   call name                 run a subroutine
+#   loop                      where the track resumes once every track has finished
+#   name:                     start a section of the timing report, at track level only
+
+from __future__ import print_function
+
+import sys, os, re, getopt
+
+TRACKS = ['buttons', 'left_stick', 'right_stick', 'hat']
+MAX_DURATION = 16383                      # largest two byte varint
+
+class ScriptError(Exception):
+  pass
+
+def read_header(name):
+  path = os.path.join(os.path.dirname(os.path.abspath(__file__)), name)
+  with open(path) as f:
+    return f.read()
+
+def read_buttons():
+  # Take the input names from Script.h so the two never drift apart.
+  body = re.search(r'typedef enum \{(.*?)\} Buttons_t;', read_header('Script.h'), re.S).group(1)
+  return [b.strip() for b in body.split(',') if b.strip()]
+
+def read_opcodes():
+  body = re.search(r'enum \{\s*(OP_REPEAT = 0x80.*?)\};', read_header('Script.h'), re.S).group(1)
+  names = re.findall(r'^\s*(OP_\w+)', body, re.M)
+  return dict((n, 0x80 + i) for i, n in enumerate(names))
+
+def read_slot_size():
+  match = re.search(r'#define UPLOAD_SLOT_SIZE\s+(\d+)', read_header('Upload.h'))
+  return int(match.group(1)) if match else 500
+
+def read_stack_depth():
+  match = re.search(r'#define SEQUENCER_STACK_DEPTH\s+(\d+)', read_header('Sequencer.h'))
+  return int(match.group(1)) if match else 4
+
+# SCRIPT_RAMP_RATE, with C's rounding of the division toward zero: the per-millisecond move of a ramp axis, in 8.8
+# fixed point.
+def ramp_rate(a, b, ms):
+  num = (b - a) * 256 + (ms // 2 if b >= a else -(ms // 2))
+  q = abs(num) // ms
+  return q if num >= 0 else -q
+
+# Where a ramp axis gets to by the end of its duration at the rounded rate. The sequencer puts it at b then.
+def ramp_reach(a, b, ms):
+  position = ((a << 8) | 0x80) + ramp_rate(a, b, ms) * ms
+  return min(position >> 8, b) if b >= a else max(position >> 8, b)
+
+# Parsed statements are tuples; blocks hold a list of them:
+#   ('step', button, ms, comment)   ('stick', op, args, ms, comment)
+#   ('repeat', count, block, comment, [end comment])   ('call', name, comment)
+#   ('loop', comment)   ('label', name)
+
+def parse(lines, buttons):
+  subs = []                               # (name, block) in definition order
+  warnings = []
+  tracks = {}
+  current = tracks.setdefault('buttons', [])
+  stack = []                              # open blocks: (kind, block, line number, [end comment])
+
+  def number(text, low, high, what, line):
+    if not re.match(r'^\d+$', text):
+      raise ScriptError('line {}: {} must be a number, got "{}"'.format(line, what, text))
+    value = int(text)
+    if value < low or value > high:
+      raise ScriptError('line {}: {} must be {} to {}, got {}'.format(line, what, low, high, value))
+    return value
+
+  for n, raw in enumerate(lines, 1):
+    code, _, comment = raw.partition('#')
+    comment = comment.strip()
+    words = code.split()
+    if not words:
+      continue
+
+    block = stack[-1][1] if stack else current
+    keyword = words[0].lower()
+    args = words[1:]
+
+    def expect(count):
+      if len(args) != count:
+        raise ScriptError('line {}: "{}" takes {} argument(s)'.format(n, words[0], count))
+
+    if len(words) == 1 and words[0].endswith(':'):
+      if stack:
+        raise ScriptError('line {}: sections can only start at track level'.format(n))
+      block.append(('label', words[0][:-1]))
+    elif keyword == 'track':
+      expect(1)
+      if stack:
+        raise ScriptError('line {}: "track" inside a block'.format(n))
+      if args[0] not in TRACKS:
+        raise ScriptError('line {}: unknown track "{}", use one of {}'.format(n, args[0], ', '.join(TRACKS)))
+      current = tracks.setdefault(args[0], [])
+    elif keyword == 'sub':
+      expect(1)
+      if stack:
+        raise ScriptError('line {}: subroutines must be defined at top level'.format(n))
+      if not re.match(r'^[A-Za-z_]\w*$', args[0]) or args[0] in [s[0] for s in subs]:
+        raise ScriptError('line {}: bad or duplicate subroutine name "{}"'.format(n, args[0]))
+      subs.append((args[0], []))
+      stack.append(('sub', subs[-1][1], n, ['']))
+    elif keyword == 'repeat':
+      expect(1)
+      body, end = [], ['']
+      block.append(('repeat', number(args[0], 1, 255, 'repeat count', n), body, comment, end))
+      stack.append(('repeat', body, n, end))
+    elif keyword == 'end':
+      expect(0)
+      if not stack:
+        raise ScriptError('line {}: "end" without "repeat" or "sub"'.format(n))
+      stack.pop()[3][0] = comment
+    elif keyword == 'call':
+      expect(1)
+      block.append(('call', args[0], comment))
+    elif keyword == 'loop':
+      expect(0)
+      if stack:
+        raise ScriptError('line {}: "loop" must be at track level'.format(n))
+      if any(s[0] == 'loop' for s in block):
+        raise ScriptError('line {}: the track already has a loop point'.format(n))
+      block.append(('loop', comment))
+    elif keyword == 'wait':
+      expect(1)
+      block.append(('step', 'NOTHING', number(args[0], 1, 10**9, 'duration', n), comment))
+    elif keyword in ('lstick', 'rstick'):
+      expect(3)
+      xy = [number(a, 0, 255, 'stick position', n) for a in args[:2]]
+      block.append(('stick', keyword, xy, number(args[2], 1, 10**9, 'duration', n), comment))
+    elif keyword in ('lramp', 'rramp'):
+      expect(5)
+      xy = [number(a, 0, 255, 'stick position', n) for a in args[:4]]
+      ms = number(args[4], 2, MAX_DURATION, 'ramp duration', n)
+      # Too shallow for the rates to carry the stick all the way, the ramp jumps to its end as it runs out. A step of
+      # one at the end is rounding, unless it's the only move there is.
+      for a, b in ((xy[0], xy[2]), (xy[1], xy[3])):
+        reach = ramp_reach(a, b, ms)
+        if abs(b - reach) > 1 or (reach == a != b):
+          warnings.append('line {}: the ramp from {} to {} only sweeps to {} in {} ms, then jumps to {}'.format(
+            n, a, b, reach, ms, b))
+      block.append(('stick', keyword, xy, ms, comment))
+    elif words[0].upper() in buttons:
+      expect(1)
+      block.append(('step', words[0].upper(), number(args[0], 1, 10**9, 'duration', n), comment))
+    else:
+      raise ScriptError('line {}: unknown statement "{}"'.format(n, words[0]))
+
+  if stack:
+    raise ScriptError('line {}: "{}" is never closed with "end"'.format(stack[-1][2], stack[-1][0]))
+
+  names = [s[0] for s in subs]
+  def check_calls(block):
+    for s in block:
+      if s[0] == 'call' and s[1] not in names:
+        raise ScriptError('call to undefined subroutine "{}"'.format(s[1]))
+      if s[0] == 'repeat':
+        check_calls(s[2])
+  for _, block in subs:
+    check_calls(block)
+  for block in tracks.values():
+    check_calls(block)
+
+  return subs, dict((t, b) for t, b in tracks.items() if b), warnings
+
+# Long holds are split into as many commands as needed.
+def split(ms):
+  while ms > MAX_DURATION:
+    yield MAX_DURATION
+    ms -= MAX_DURATION
+  yield ms
+
+def duration_size(ms):
+  return 1 if ms < 128 else 2
+
+# Emit one block as (C text, comment) lines and return its size in bytes.
+def emit(block, out, indent):
+  size = 0
+  for s in block:
+    kind = s[0]
+    if kind == 'step':
+      for ms in split(s[2]):
+        macro = 'STEP' if ms < 128 else 'STEP_LONG'
+        button = (s[1] + ',').ljust(max(9, len(s[1]) + 2))
+        out.append((indent + '{}({}{:>5}),'.format(macro, button, ms), s[3]))
+        size += 1 + duration_size(ms)
+        s = s[:3] + ('',)
+    elif kind == 'stick':
+      macro = s[1].upper()
+      for ms in (split(s[3]) if macro.endswith('STICK') else [s[3]]):
+        out.append((indent + '{}({}, {}),'.format(macro, ', '.join(str(v) for v in s[2]), ms), s[4]))
+        size += 1 + len(s[2]) + (4 if macro.endswith('RAMP') else 0) + 2
+        s = s[:4] + ('',)
+    elif kind == 'repeat':
+      out.append((indent + 'REPEAT({}),'.format(s[1]), s[3]))
+      size += 2 + emit(s[2], out, indent + '\t')
+      out.append((indent + 'END_REPEAT,', s[4][0]))
+      size += 1
+    elif kind == 'call':
+      out.append((indent + 'CALL(SUB_{}),'.format(s[1].upper()), s[2]))
+      size += 2
+    elif kind == 'loop':
+      if out and out[-1][0]:
+        out.append(('', ''))
+      out.append((indent + 'LOOP_POINT,', s[1]))
+      size += 1
+    elif kind == 'label':
+      if out and out[-1][0]:
+        out.append(('', ''))
+      out.append((indent + '// ' + s[1], ''))
+  return size
+
+# The same streams as bytes, for the uploaded image. Must match what the Script.h macros expand to.
+def encode(block, buttons, ops, sub_index):
+  def duration(ms, long_form):
+    if ms < 128 and not long_form:
+      return [ms]
+    return [0x80 | (ms & 0x7F), ms >> 7]
+
+  def rate(a, b, ms):
+    q = ramp_rate(a, b, ms)
+    return [q & 0xFF, (q >> 8) & 0xFF]
+
+  data = []
+  for s in block:
+    kind = s[0]
+    if kind == 'step':
+      for ms in split(s[2]):
+        data += [buttons.index(s[1])] + duration(ms, False)
+    elif kind == 'stick':
+      op = ops['OP_' + s[1].upper()]
+      if s[1].endswith('stick'):
+        for ms in split(s[3]):
+          data += [op] + s[2] + duration(ms, True)
+      else:
+        x0, y0, x1, y1 = s[2]
+        data += [op] + s[2] + rate(x0, x1, s[3]) + rate(y0, y1, s[3]) + duration(s[3], True)
+    elif kind == 'repeat':
+      data += [ops['OP_REPEAT'], s[1]] + encode(s[2], buttons, ops, sub_index) + [ops['OP_END_REPEAT']]
+    elif kind == 'call':
+      data += [ops['OP_CALL'], sub_index[s[1]]]
+    elif kind == 'loop':
+      data += [ops['OP_LOOP_POINT']]
+  return data
+
+# A Script_t for the EEPROM: every pointer is a 16 bit offset from the start of the image, zero for none.
+def build_image(subs, tracks, title, buttons):
+  ops = read_opcodes()
+  sub_index = dict((name, i) for i, (name, _) in enumerate(subs))
+  header = 2 * (len(TRACKS) + 2) + 1
+  table = header
+  name = table + 2 * len(subs)
+  body = list(bytearray(title.encode('ascii'))) + [0]
+  subs_at = []
+  for _, block in subs:
+    subs_at.append(name + len(body))
+    body += encode(block, buttons, ops, sub_index) + [ops['OP_RETURN']]
+  tracks_at = []
+  for track in TRACKS:
+    if track in tracks:
+      tracks_at.append(name + len(body))
+      body += encode(tracks[track], buttons, ops, sub_index) + [ops['OP_END_SCRIPT']]
+    else:
+      tracks_at.append(0)
+
+  image = []
+  for w in tracks_at + [table if subs else 0, name]:
+    image += [w & 0xFF, w >> 8]
+  image += [len(subs)]
+  for w in subs_at:
+    image += [w & 0xFF, w >> 8]
+  return bytearray(image + body)
+
+def format_lines(lines):
+  width = max([len(l.expandtabs(4)) for l, c in lines if c] + [0])
+  text = ''
+  for line, comment in lines:
+    if comment:
+      line += ' ' * (width - len(line.expandtabs(4)) + 1) + '// ' + comment
+    text += line.rstrip() + '\n'
+  return text
+
+# Time taken by a block, with repeats and calls expanded.
+def block_time(block, subs, seen=()):
+  total = 0
+  for s in block:
+    if s[0] == 'step':
+      total += s[2]
+    elif s[0] == 'stick':
+      total += s[3]
+    elif s[0] == 'repeat':
+      total += s[1] * block_time(s[2], subs, seen)
+    elif s[0] == 'call':
+      if s[1] in seen:
+        raise ScriptError('subroutine "{}" ends up calling itself'.format(s[1]))
+      total += block_time(subs[s[1]], subs, seen + (s[1],))
+  return total
+
+# Deepest nesting of repeats and calls, which is what the sequencer has to stack.
+def block_depth(block, subs):
+  depth = 0
+  for s in block:
+    if s[0] == 'repeat':
+      depth = max(depth, 1 + block_depth(s[2], subs))
+    elif s[0] == 'call':
+      depth = max(depth, 1 + block_depth(subs[s[1]], subs))
+  return depth
+
+def seconds(ms):
+  return '{:.3f} s'.format(ms / 1000.0)
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "bho:q")
+  output = None
+  quiet = False
+  binary = False
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-o':
+      output = arg
+    elif opt == '-q':
+      quiet = True
+    elif opt == '-b':
+      binary = True
+
+  source = args[0]
+  base = output or os.path.splitext(source)[0] + '_script'
+  name = re.sub(r'\W', '_', os.path.basename(base))
+  title = os.path.splitext(os.path.basename(source))[0]
+
+  buttons = read_buttons()
+  try:
+    with open(source) as f:
+      subs, tracks, warnings = parse(f.read().splitlines(), buttons)
+    sub_blocks = dict(subs)
+    for block in list(sub_blocks.values()) + list(tracks.values()):
+      block_time(block, sub_blocks)
+    depth = max([block_depth(b, sub_blocks) for b in tracks.values()] + [0])
+    if depth > read_stack_depth():
+      raise ScriptError('repeats and calls nest {} deep, the sequencer only stacks {}'.format(depth, read_stack_depth()))
+  except ScriptError as e:
+    print('{}: {}'.format(source, e), file=sys.stderr)
+    sys.exit(1)
+
+  for warning in warnings:
+    print('{}: warning: {}'.format(source, warning), file=sys.stderr)
+
+  stream_bytes = 0
+  c = '// Generated by script2c.py from {}, edit that instead.\n\n'.format(os.path.basename(source))
+  c += '#include "{}.h"\n'.format(os.path.basename(base))
+  c += '\nstatic const char name[] PROGMEM = "{}";\n'.format(title)
+
+  if subs:
+    c += '\nenum {\n' + ',\n'.join('\tSUB_' + s.upper() for s, _ in subs) + '\n};\n'
+    for sub, block in subs:
+      lines = []
+      stream_bytes += emit(block, lines, '\t') + 1
+      c += '\nstatic const uint8_t sub_{}[] PROGMEM = {{\n'.format(sub) + format_lines(lines) + '\tRETURN\n};\n'
+    c += '\nstatic const uint8_t* const subroutines[] PROGMEM = {\n'
+    c += ',\n'.join('\t[SUB_{}] = sub_{}'.format(s.upper(), s) for s, _ in subs) + '\n};\n'
+
+  for track in TRACKS:
+    if track in tracks:
+      lines = []
+      stream_bytes += emit(tracks[track], lines, '\t') + 1
+      c += '\nstatic const uint8_t track_{}[] PROGMEM = {{\n'.format(track) + format_lines(lines) + '\n\tEND_SCRIPT\n};\n'
+
+  c += '\nconst Script_t {} PROGMEM = {{\n'.format(name)
+  c += '\t.Tracks          = {{ {} }},\n'.format(', '.join('[TRACK_{}] = track_{}'.format(t.upper(), t) for t in TRACKS if t in tracks))
+  c += '\t.Subroutines     = {},\n'.format('subroutines' if subs else 'NULL')
+  c += '\t.Name            = name,\n'
+  c += '\t.SubroutineCount = {}\n}};\n'.format(len(subs))
+
+  guard = '_' + name.upper() + '_H_'
+  h = '// Generated by script2c.py from {}, edit that instead.\n\n'.format(os.path.basename(source))
+  h += '#ifndef {0}\n#define {0}\n\n#include "Script.h"\n\n'.format(guard)
+  h += 'extern const Script_t {} PROGMEM;\n\n#endif\n'.format(name)
+
+  with open(base + '.c', 'w') as f:
+    f.write(c)
+  with open(base + '.h', 'w') as f:
+    f.write(h)
+
+  if binary:
+    image = build_image(subs, tracks, title, buttons)
+    if len(image) > read_slot_size():
+      print('{}: the image takes {} bytes, an upload slot only holds {}'.format(source, len(image), read_slot_size()), file=sys.stderr)
+      sys.exit(1)
+    with open(base + '.bin', 'wb') as f:
+      f.write(image)
+    if not quiet:
+      print('{}.bin: {} of {} bytes of an upload slot'.format(base, len(image), read_slot_size()))
+
+  if quiet:
+    return
+
+  # Every track restarts from its loop point once the slowest one has finished.
+  print('{} compiled to {}.c and {}.h'.format(source, base, base))
+  first, period = 0, 0
+  for track in TRACKS:
+    if track not in tracks:
+      continue
+    block = tracks[track]
+    loop = [i for i, s in enumerate(block) if s[0] == 'loop']
+    head = block[:loop[0]] if loop else []
+    total = block_time(block, sub_blocks)
+    first, period = max(first, total), max(period, total - block_time(head, sub_blocks))
+    print('track {}: {}, {} per loop'.format(track, seconds(total), seconds(total - block_time(head, sub_blocks))))
+
+    section, start = None, []
+    for s in block + [('label', None)]:
+      if s[0] == 'label':
+        if start:
+          print('  {:<24} {:>12}'.format(section or '(unnamed)', seconds(block_time(start, sub_blocks))))
+        section, start = s[1], []
+      else:
+        start.append(s)
+
+  print('first pass {}, then {} per loop'.format(seconds(first), seconds(period)))
+  table = 2 * len(subs)
+  header = 2 * (len(TRACKS) + 2) + 1 + len(title) + 1
+  print('flash: {} bytes ({} of command streams, {} of subroutine table, {} of Script_t and name)'.format(
+    stream_bytes + table + header, stream_bytes, table, header))
+  print('SRAM: none, the script is read from flash in place')
+
+def usage():
+  print("To compile yourScript.script to yourScript_script.c and .h: script2c.py yourScript.script")
+  print("To choose the output name: script2c.py -o name yourScript.script")
+  print("To skip the timing report: script2c.py -q yourScript.script")
+  print("To also write the image for upload.py: script2c.py -b yourScript.script")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,179 @@
+#!/bin/python
+
+# Streams timed reports from a PC to a running firmware, which plays them
+# instead of its script (see Stream.c). Needs pyusb, and on Linux access to the
+# device (root or a udev rule). It doesn't work with the Switch, only a PC can
+# drive the controller this way.
+#
+#   stream.py moves.txt               play a file
+#   mybot | stream.py -               play what another program writes, as it writes it
+#
+# One report per line, '#' starts a comment:
+#
+#   duration [input ...]
+#
+# holds the inputs for duration milliseconds. An input is a button (A, B, X, Y,
+# L, R, ZL, ZR, MINUS, PLUS, LCLICK, RCLICK, HOME, CAPTURE), `hat DIRECTION`
+# (TOP, TOP_RIGHT, RIGHT, ... of Joystick.h), or `lstick x y` / `rstick x y`
+# with positions from 0 to 255. A line with only a duration lets go of everything.
+
+from __future__ import print_function
+
+import sys, os, re, struct, time, getopt
+import usb.core
+
+VENDOR_ID = 0x0F0D
+PRODUCT_ID = 0x0092
+PRO_VENDOR_ID = 0x057E                    # Built with `make pro`
+PRO_PRODUCT_ID = 0x2009
+
+REQ_START, REQ_STOP, REQ_STATUS = range(6, 9)
+OUT = 0x40                                # vendor request to the device, host to device
+IN = 0xC0                                 # same, device to host
+OUT_ENDPOINT = 0x02                       # JOYSTICK_OUT_EPADDR
+PACKET_SIZE = 64                          # JOYSTICK_EPSIZE
+ENTRY = struct.Struct('<HBBBBBH')         # StreamEntry_t
+MAX_DURATION = 32767
+
+class StreamError(Exception):
+  pass
+
+def read_header(name):
+  path = os.path.join(os.path.dirname(os.path.abspath(__file__)), name)
+  with open(path) as f:
+    return f.read()
+
+def read_inputs():
+  # Take the button and hat names from Joystick.h so the two never drift apart.
+  header = read_header('Joystick.h')
+  buttons = dict((n, int(v, 16)) for n, v in re.findall(r'SWITCH_(\w+)\s*=\s*(0x[0-9A-Fa-f]+)', header))
+  hats = dict((n, int(v, 16)) for n, v in re.findall(r'#define HAT_(\w+)\s+(0x[0-9A-Fa-f]+)', header))
+  return buttons, hats
+
+def parse(line, n, buttons, hats):
+  words = line.partition('#')[0].upper().split()
+  if not words:
+    return []
+
+  def number(text, high, what):
+    if not re.match(r'^\d+$', text) or int(text) > high:
+      raise StreamError('line {}: {} must be a number from 0 to {}, got "{}"'.format(n, what, high, text))
+    return int(text)
+
+  ms = number(words[0], 10**9, 'duration')
+  button, hat, sticks = 0, hats['CENTER'], {'LSTICK': [128, 128], 'RSTICK': [128, 128]}
+  rest = words[1:]
+  while rest:
+    word = rest.pop(0)
+    if word in buttons:
+      button |= buttons[word]
+    elif word == 'HAT' and rest and rest[0] in hats:
+      hat = hats[rest.pop(0)]
+    elif word in sticks and len(rest) >= 2:
+      sticks[word] = [number(rest.pop(0), 255, 'stick position') for _ in range(2)]
+    else:
+      raise StreamError('line {}: unknown input "{}"'.format(n, word))
+
+  # Holds too long for one entry are split into as many as needed.
+  entries = []
+  while True:
+    entries.append(ENTRY.pack(button, hat, sticks['LSTICK'][0], sticks['LSTICK'][1],
+                              sticks['RSTICK'][0], sticks['RSTICK'][1], min(ms, MAX_DURATION)))
+    ms -= MAX_DURATION
+    if ms <= 0:
+      return entries
+
+def status(dev):
+  return struct.unpack('<BBHH', bytes(bytearray(dev.ctrl_transfer(IN, REQ_STATUS, 0, 0, 6))))
+
+def entries(source, buttons, hats):
+  for n, line in enumerate(iter(source.readline, ''), 1):
+    for entry in parse(line, n, buttons, hats):
+      yield entry
+
+def play(dev, source, buttons, hats):
+  sent = 0
+  pending = []
+  lines = entries(source, buttons, hats)
+  done = False
+
+  while not done or pending:
+    # Only ever send what the ring has room for, so the endpoint never blocks.
+    credits = status(dev)[1]
+    while not done and len(pending) < credits:
+      try:
+        pending.append(next(lines))
+      except StopIteration:
+        done = True
+
+    if not credits or not pending:
+      time.sleep(0.005)
+      continue
+
+    batch = pending[:min(credits, PACKET_SIZE // ENTRY.size)]
+    dev.write(OUT_ENDPOINT, b''.join(batch))
+    pending = pending[len(batch):]
+    sent += len(batch)
+
+  # Let the last entries play out, and a few polls more for the ring to be seen empty.
+  while status(dev)[2] != sent & 0xFFFF:
+    time.sleep(0.005)
+  if sent:
+    time.sleep(ENTRY.unpack(batch[-1])[-1] / 1000.0 + 0.05)
+  return sent
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hk")
+  keep = False
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-k':
+      keep = True
+
+  buttons, hats = read_inputs()
+  source = sys.stdin if args[0] == '-' else open(args[0])
+
+  dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+  if dev is None:
+    dev = usb.core.find(idVendor=PRO_VENDOR_ID, idProduct=PRO_PRODUCT_ID)
+  if dev is None:
+    print("ERROR: No controller found!")
+    sys.exit(1)
+
+  # The OUT endpoint belongs to the HID driver until we take it.
+  if dev.is_kernel_driver_active(0):
+    dev.detach_kernel_driver(0)
+
+  dev.ctrl_transfer(OUT, REQ_START, 0, 0, None)
+  start = time.time()
+  try:
+    sent = play(dev, source, buttons, hats)
+  except StreamError as e:
+    print('{}: {}'.format(args[0], e), file=sys.stderr)
+    keep = False
+    sys.exit(1)
+  except KeyboardInterrupt:
+    keep = False
+    sys.exit(1)
+  finally:
+    underruns = status(dev)[3]
+    if not keep:
+      dev.ctrl_transfer(OUT, REQ_STOP, 0, 0, None)
+
+  # The last entry running out counts as one underrun.
+  print("{} reports played in {:.1f} s, the controller ran dry {} time(s)".format(sent, time.time() - start, max(underruns - 1, 0)))
+
+def usage():
+  print("To play a file of timed reports: stream.py moves.txt")
+  print("To play what another program writes: yourProgram | stream.py -")
+  print("To stay in streaming mode (neutral) rather than go back to the script: stream.py -k moves.txt")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])
@@ -0,0 +1,109 @@
+#!/bin/python
+
+# Reads the telemetry interface of a firmware built with `make telemetry` (see
+# Telemetry.c). Needs pyusb, and on Linux access to the device (root or a udev
+# rule). The joystick interface is left alone, so the controller keeps playing
+# to whatever else it is plugged into.
+#
+# Track positions are byte offsets into each track's command stream, the same
+# offsets as the streams in the script's generated _script.c.
+
+from __future__ import print_function
+
+import sys, struct, time, getopt
+import usb.core
+
+VENDOR_ID = 0x0F0D
+PRODUCT_ID = 0x0092
+PRO_VENDOR_ID = 0x057E                    # Built with `make pro`
+PRO_PRODUCT_ID = 0x2009
+
+INTERFACE = 1                             # INTERFACE_ID_Telemetry
+IN_ENDPOINT = 0x83                        # TELEMETRY_IN_EPADDR
+OUT_ENDPOINT = 0x04                       # TELEMETRY_OUT_EPADDR
+REPORT_SIZE = 32                          # TELEMETRY_EPSIZE
+
+CMD_STATUS, CMD_TRACE, CMD_RESTART = range(1, 4)
+TRACKS = ['buttons', 'left_stick', 'right_stick', 'hat']
+STATUS = struct.Struct('<BHBBH4HHHHH')    # TelemetryStatus_t
+TRACE_ENTRY = struct.Struct('<HHBBBBB')   # TelemetryTraceEntry_t
+SCRIPT_UPLOADED = 0xFE
+
+def command(dev, cmd):
+  dev.write(OUT_ENDPOINT, bytes(bytearray([cmd] + [0] * (REPORT_SIZE - 1))))
+  # Answers to earlier commands we gave up on may still be queued; skip them.
+  while True:
+    answer = bytes(bytearray(dev.read(IN_ENDPOINT, REPORT_SIZE, 1000)))
+    if bytearray(answer)[0] == cmd:
+      return answer
+
+def print_status(dev):
+  fields = STATUS.unpack(command(dev, CMD_STATUS)[:STATUS.size])
+  time_ms, setting, streaming, loops = fields[1:5]
+  positions = fields[5:9]
+  stalls, missed, deferred, lost = fields[9:]
+
+  source = 'stream' if streaming else ('uploaded script' if setting == SCRIPT_UPLOADED else 'script {}'.format(setting))
+  print('{:>6} ms  {}  loop {}'.format(time_ms, source, loops))
+  print('  ' + '  '.join('{} @{}'.format(t, p) for t, p in zip(TRACKS, positions) if p != 0xFFFF))
+  print('  stalls {}  missed polls {}  deferred reports {}  trace lost {}'.format(stalls, missed, deferred, lost))
+
+def print_trace(dev):
+  while True:
+    answer = command(dev, CMD_TRACE)
+    count = bytearray(answer)[1]
+    if not count:
+      return
+    for i in range(count):
+      t, button, hat, lx, ly, rx, ry = TRACE_ENTRY.unpack_from(answer, 2 + i * TRACE_ENTRY.size)
+      print('{:>6} ms  buttons {:04x}  hat {}  left {:>3} {:>3}  right {:>3} {:>3}'.format(t, button, hat, lx, ly, rx, ry))
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hrtw:")
+  action = print_status
+  interval = None
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-r':
+      action = None
+    elif opt == '-t':
+      action = print_trace
+    elif opt == '-w':
+      interval = float(arg)
+
+  dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+  if dev is None:
+    dev = usb.core.find(idVendor=PRO_VENDOR_ID, idProduct=PRO_PRODUCT_ID)
+  if dev is None:
+    print("ERROR: No controller found!")
+    sys.exit(1)
+  if dev.get_active_configuration().bNumInterfaces <= INTERFACE:
+    print("ERROR: This firmware has no telemetry interface, build it with `make telemetry`")
+    sys.exit(1)
+
+  # Only the telemetry interface is taken from the HID driver, the joystick stays with it.
+  if dev.is_kernel_driver_active(INTERFACE):
+    dev.detach_kernel_driver(INTERFACE)
+
+  if action is None:
+    command(dev, CMD_RESTART)
+    print("The script started over")
+    return
+
+  while True:
+    action(dev)
+    if interval is None:
+      break
+    time.sleep(interval)
+
+def usage():
+  print("To show the counters and where the script is: telemetry.py")
+  print("To show the reports sent since the last time: telemetry.py -t")
+  print("To keep showing either every n seconds: telemetry.py -w n [-t]")
+  print("To start the script over: telemetry.py -r")
+
+if __name__ == "__main__":
+  main(sys.argv[1:])
@@ -0,0 +1,107 @@
+#!/bin/python
+
+# Sends a script image (script2c.py -b) to the EEPROM of a running firmware
+# over USB, or picks which script it runs. Needs pyusb, and on Linux access to
+# the device (root or a udev rule).
+#
+# The requests are the vendor requests of Upload.h.
+
+from __future__ import print_function
+
+import sys, struct, time, getopt
+import usb.core
+
+VENDOR_ID = 0x0F0D
+PRODUCT_ID = 0x0092
+PRO_VENDOR_ID = 0x057E                    # Built with `make pro`
+PRO_PRODUCT_ID = 0x2009
+
+REQ_BEGIN, REQ_DATA, REQ_COMMIT, REQ_SELECT, REQ_STATUS = range(1, 6)
+RESULTS = ['ok', 'image does not fit the slot', 'CRC mismatch, the slot was not switched']
+SCRIPT_UPLOADED = 0xFE
+CHUNK_SIZE = 64
+
+OUT = 0x40                                # vendor request to the device, host to device
+IN = 0xC0                                 # same, device to host
+
+def crc16(data):
+  # _crc16_update from avr-libc, starting from 0xFFFF.
+  crc = 0xFFFF
+  for byte in bytearray(data):
+    crc ^= byte
+    for _ in range(8):
+      crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+  return crc
+
+def status(dev):
+  busy, result, setting, slot, slot_size = struct.unpack('<BBBBH', bytes(bytearray(dev.ctrl_transfer(IN, REQ_STATUS, 0, 0, 6))))
+  return busy, result, setting, slot, slot_size
+
+def request(dev, req, value=0, index=0, data=None):
+  # The firmware stalls requests while it is still writing the last one to EEPROM.
+  for attempt in range(200):
+    try:
+      dev.ctrl_transfer(OUT, req, value, index, data)
+      break
+    except usb.core.USBError:
+      time.sleep(0.01)
+  else:
+    raise IOError('the device keeps refusing request {}'.format(req))
+
+  while True:
+    busy, result = status(dev)[:2]
+    if not busy:
+      break
+    time.sleep(0.01)
+
+  if result:
+    print('ERROR: {}'.format(RESULTS[result] if result < len(RESULTS) else result))
+    sys.exit(1)
+
+def main(argv):
+  opts, args = getopt.getopt(argv, "hs:")
+  select = None
+
+  for opt, arg in opts:
+    if opt == '-h':
+      usage()
+      sys.exit()
+    elif opt == '-s':
+      select = SCRIPT_UPLOADED if arg == 'uploaded' else int(arg)
+
+  dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+  if dev is None:
+    dev = usb.core.find(idVendor=PRO_VENDOR_ID, idProduct=PRO_PRODUCT_ID)
+  if dev is None:
+    print("ERROR: No controller found!")
+    sys.exit(1)
+
+  if select is not None:
+    request(dev, REQ_SELECT, select)
+    print("Now running script {}".format('uploaded' if select == SCRIPT_UPLOADED else select))
+    return
+
+  image = open(args[0], 'rb').read()
+  slot_size = status(dev)[4]
+  if len(image) > slot_size:
+    print("ERROR: {} takes {} bytes, the upload slot holds {}".format(args[0], len(image), slot_size))
+    sys.exit(1)
+
+  start = time.time()
+  request(dev, REQ_BEGIN, len(image))
+  for offset in range(0, len(image), CHUNK_SIZE):
+    request(dev, REQ_DATA, 0, offset, image[offset:offset + CHUNK_SIZE])
+  request(dev, REQ_COMMIT, crc16(image))
+  print("{} uploaded in {:.1f} s and running from slot {}".format(args[0], time.time() - start, status(dev)[3]))
+
+def usage():
+  print("To upload and run a script: upload.py yourScript_script.bin")
+  print("To run script n of the firmware's bank: upload.py -s n")
+  print("To go back to the uploaded script: upload.py -s uploaded")
+
+if __name__ == "__main__":
+  if len(sys.argv[1:]) == 0:
+    usage()
+    sys.exit()
+  else:
+    main(sys.argv[1:])